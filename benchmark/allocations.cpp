@@ -0,0 +1,46 @@
+// ====================================================================
+// This file is part of tsil-mma.
+//
+// tsil-mma is licenced under the GNU General Public License (GNU GPL)
+// version 3.
+// ====================================================================
+
+// Replaces the global operator new to count the heap allocations.
+
+#include "allocations.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<std::uint64_t> allocations{0};
+
+} // anonymous namespace
+
+std::uint64_t number_of_allocations()
+{
+   return allocations.load();
+}
+
+void* operator new(std::size_t size)
+{
+   allocations++;
+
+   if (void* p = std::malloc(size ? size : 1)) {
+      return p;
+   }
+
+   throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+   return operator new(size);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
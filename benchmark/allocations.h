@@ -0,0 +1,16 @@
+// ====================================================================
+// This file is part of tsil-mma.
+//
+// tsil-mma is licenced under the GNU General Public License (GNU GPL)
+// version 3.
+// ====================================================================
+
+#ifndef TSIL_MMA_ALLOCATIONS_H
+#define TSIL_MMA_ALLOCATIONS_H
+
+#include <cstdint>
+
+/// number of calls of the global operator new since program start
+std::uint64_t number_of_allocations();
+
+#endif
@@ -0,0 +1,241 @@
+// ====================================================================
+// This file is part of tsil-mma.
+//
+// tsil-mma is licenced under the GNU General Public License (GNU GPL)
+// version 3.
+// ====================================================================
+
+// Measures the time and the number of heap allocations per call of
+//
+//  * the analytic TSIL functions (TSIL_Sanalytic_, TSIL_Uanalytic_, ...),
+//  * the numerical integration with TSIL_Evaluate_,
+//  * the LibraryLink entry points, with MathLink replaced by an
+//    in-process mock (see mock/mathlink.h),
+//
+// for several mass configurations.  Usage:
+//
+//   benchmark_core [seconds per measurement]
+
+#include "allocations.h"
+#include "tsil_mma.h"
+
+#include "mathlink.h"
+#include "WolframLibrary.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+/******************************************************************/
+
+// entry points from librarylink.cpp
+extern "C" {
+int TSILEvaluate(WolframLibraryData, MLINK);
+int TSILB(WolframLibraryData, MLINK);
+int TSILS(WolframLibraryData, MLINK);
+int TSILM(WolframLibraryData, MLINK);
+int TSILBNative(WolframLibraryData, mint, MArgument*, MArgument);
+}
+
+namespace {
+
+using namespace tsil_mma;
+
+struct Configuration {
+   const char* name;
+   TSIL_REAL x, y, z, u, v;
+   TSIL_COMPLEXCPP s;
+   TSIL_REAL qq;
+};
+
+const std::vector<Configuration>& configurations()
+{
+   // s slightly above the threshold of B(x,z)
+   const TSIL_REAL s_thr = std::pow(1 + std::sqrt(TSIL_REAL(3)), 2) + TSIL_REAL(1e-6);
+
+   static const std::vector<Configuration> confs{
+      {"generic"       , 1, 2, 3, 4, 5, {10, 0}, 1},
+      {"degenerate"    , 1, 1, 1, 1, 1, {10, 0}, 1},
+      {"near-threshold", 1, 2, 3, 4, 5, {s_thr, 0}, 1},
+      {"zero-mass"     , 0, 2, 0, 4, 0, {10, 0}, 1},
+   };
+
+   return confs;
+}
+
+double min_seconds = 0.2;
+
+/**
+ * Calls f() repeatedly for at least min_seconds and prints the time
+ * and the number of allocations per call.
+ */
+template <class F>
+void measure(const char* stage, const char* function, const Configuration& conf, F&& f)
+{
+   using Clock = std::chrono::steady_clock;
+
+   std::uint64_t calls = 0;
+   const auto allocations_before = number_of_allocations();
+   const auto start = Clock::now();
+   double seconds = 0;
+
+   do {
+      f();
+      calls++;
+      seconds = std::chrono::duration<double>(Clock::now() - start).count();
+   } while (seconds < min_seconds);
+
+   const auto allocations = number_of_allocations() - allocations_before;
+
+   std::printf("%-12s %-18s %-16s %14.1f ns/call %10.2f allocs/call\n",
+               stage, function, conf.name, 1e9*seconds/calls,
+               static_cast<double>(allocations)/calls);
+}
+
+/// prevents that results are optimized away
+volatile TSIL_REAL sink = 0;
+
+void consume(TSIL_COMPLEXCPP val)
+{
+   sink = sink + std::real(val);
+}
+
+/******************************************************************/
+
+void benchmark_analytic(const Configuration& c)
+{
+   const char* stage = "analytic";
+   TSIL_COMPLEXCPP res;
+
+   measure(stage, "A", c, [&] { consume(TSIL_A_(c.x, c.qq)); });
+   measure(stage, "B", c, [&] { consume(TSIL_B_(c.x, c.z, c.s, c.qq)); });
+   measure(stage, "I", c, [&] { consume(TSIL_I2_(c.x, c.y, c.z, c.qq)); });
+
+   if (TSIL_Sanalytic_(c.x, c.y, c.z, c.s, c.qq, &res)) {
+      measure(stage, "Sanalytic", c, [&] {
+         TSIL_Sanalytic_(c.x, c.y, c.z, c.s, c.qq, &res); consume(res); });
+   }
+   if (TSIL_Tanalytic_(c.x, c.y, c.z, c.s, c.qq, &res)) {
+      measure(stage, "Tanalytic", c, [&] {
+         TSIL_Tanalytic_(c.x, c.y, c.z, c.s, c.qq, &res); consume(res); });
+   }
+   if (TSIL_Tbaranalytic_(c.x, c.y, c.z, c.s, c.qq, &res)) {
+      measure(stage, "Tbaranalytic", c, [&] {
+         TSIL_Tbaranalytic_(c.x, c.y, c.z, c.s, c.qq, &res); consume(res); });
+   }
+   if (TSIL_Uanalytic_(c.x, c.y, c.z, c.u, c.s, c.qq, &res)) {
+      measure(stage, "Uanalytic", c, [&] {
+         TSIL_Uanalytic_(c.x, c.y, c.z, c.u, c.s, c.qq, &res); consume(res); });
+   }
+   if (TSIL_Vanalytic_(c.x, c.y, c.z, c.u, c.s, c.qq, &res)) {
+      measure(stage, "Vanalytic", c, [&] {
+         TSIL_Vanalytic_(c.x, c.y, c.z, c.u, c.s, c.qq, &res); consume(res); });
+   }
+   if (TSIL_Manalytic_(c.x, c.y, c.z, c.u, c.v, c.s, &res)) {
+      measure(stage, "Manalytic", c, [&] {
+         TSIL_Manalytic_(c.x, c.y, c.z, c.u, c.v, c.s, &res); consume(res); });
+   }
+}
+
+void benchmark_evaluate(const Configuration& c)
+{
+   const char* stage = "evaluate";
+   const auto data = std::make_unique<TSIL_DATA>();
+
+   measure(stage, "TSIL_Evaluate_", c, [&] {
+      TSIL_SetParameters_(data.get(), c.x, c.y, c.z, c.u, c.v, c.qq);
+      TSIL_Evaluate_(data.get(), std::real(c.s));
+      consume(TSIL_GetFunction_(data.get(), "M"));
+   });
+
+   const Parameters pars{c.x, c.y, c.z, c.u, c.v, std::real(c.s), std::imag(c.s), c.qq};
+
+   measure(stage, "calculate_results", c, [&] { consume(calculate_results(pars)[0]); });
+}
+
+/// calls a LinkObject entry point with the arguments List[List[args...]]
+template <class F>
+void measure_linkobject(const char* function, const Configuration& c,
+                        const std::vector<TSIL_REAL>& args, F&& entry)
+{
+   MLink link;
+   link.function("List", 1).function("List", static_cast<long>(args.size()));
+
+   for (const auto a: args) {
+      link.real(a);
+   }
+
+   const auto libData = mock_library_data();
+
+   // fill the cache
+   entry(libData, &link);
+
+   measure("librarylink", function, c, [&] {
+      link.rewind();
+      entry(libData, &link);
+   });
+}
+
+void benchmark_librarylink(const Configuration& c)
+{
+   const TSIL_REAL re_s = std::real(c.s), im_s = std::imag(c.s);
+
+   measure_linkobject("TSILEvaluate", c, {c.x, c.y, c.z, c.u, c.v, re_s, im_s, c.qq}, TSILEvaluate);
+   measure_linkobject("TSILB", c, {c.x, c.z, re_s, im_s, c.qq}, TSILB);
+   measure_linkobject("TSILS", c, {c.x, c.y, c.z, re_s, im_s, c.qq}, TSILS);
+   measure_linkobject("TSILM", c, {c.x, c.y, c.z, c.u, c.v, re_s, im_s}, TSILM);
+
+   mreal x = c.x, z = c.z, qq = c.qq;
+   mcomplex s, res;
+   mcreal(s) = re_s;
+   mcimag(s) = im_s;
+
+   MArgument args[4];
+   args[0].real = &x;
+   args[1].real = &z;
+   args[2].cmplex = &s;
+   args[3].real = &qq;
+
+   MArgument result;
+   result.cmplex = &res;
+
+   const auto libData = mock_library_data();
+
+   TSILBNative(libData, 4, args, result);
+
+   measure("librarylink", "TSILBNative", c, [&] {
+      TSILBNative(libData, 4, args, result);
+   });
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[])
+{
+   if (argc > 1) {
+      min_seconds = std::atof(argv[1]);
+   }
+
+   set_number_of_threads(1);
+
+   // without cache: cost of the calculation
+   set_cache_size(0);
+
+   for (const auto& c: configurations()) {
+      benchmark_analytic(c);
+      benchmark_evaluate(c);
+   }
+
+   // with warm cache: cost of the marshalling (read_list, put_results, ...)
+   set_cache_size(64*1024*1024);
+
+   for (const auto& c: configurations()) {
+      benchmark_librarylink(c);
+   }
+
+   return 0;
+}
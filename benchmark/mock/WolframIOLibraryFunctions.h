@@ -0,0 +1,15 @@
+// ====================================================================
+// This file is part of tsil-mma.
+//
+// tsil-mma is licenced under the GNU General Public License (GNU GPL)
+// version 3.
+// ====================================================================
+
+#ifndef TSIL_MMA_MOCK_WOLFRAMIOLIBRARYFUNCTIONS_H
+#define TSIL_MMA_MOCK_WOLFRAMIOLIBRARYFUNCTIONS_H
+
+// the asynchronous task functions are declared in the mock WolframLibrary.h
+
+#include "WolframLibrary.h"
+
+#endif
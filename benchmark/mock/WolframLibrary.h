@@ -0,0 +1,104 @@
+// ====================================================================
+// This file is part of tsil-mma.
+//
+// tsil-mma is licenced under the GNU General Public License (GNU GPL)
+// version 3.
+// ====================================================================
+
+#ifndef TSIL_MMA_MOCK_WOLFRAMLIBRARY_H
+#define TSIL_MMA_MOCK_WOLFRAMLIBRARY_H
+
+/**
+ * In-process replacement of the parts of the Wolfram Library API that
+ * are used by librarylink.cpp.  The MTensor functions are not
+ * provided.
+ */
+
+#include <cstdint>
+
+#include "mathlink.h"
+
+#define DLLEXPORT
+
+#define WolframLibraryVersion 3
+
+#define LIBRARY_NO_ERROR        0
+#define LIBRARY_TYPE_ERROR      1
+#define LIBRARY_RANK_ERROR      2
+#define LIBRARY_DIMENSION_ERROR 3
+#define LIBRARY_NUMERICAL_ERROR 4
+#define LIBRARY_MEMORY_ERROR    5
+#define LIBRARY_FUNCTION_ERROR  6
+
+#define MType_Integer 2
+#define MType_Real    3
+#define MType_Complex 4
+
+typedef int64_t mint;
+typedef double mreal;
+typedef int mbool;
+
+#define True  1
+#define False 0
+
+typedef struct { mreal ri[2]; } mcomplex;
+typedef struct st_MTensor* MTensor;
+
+#define mcreal(mc) ((mc).ri[0])
+#define mcimag(mc) ((mc).ri[1])
+
+typedef union {
+   mbool* boolean;
+   mint* integer;
+   mreal* real;
+   mcomplex* cmplex;
+   MTensor* tensor;
+   char** utf8string;
+} MArgument;
+
+#define MArgument_getBoolean(a) (*((a).boolean))
+#define MArgument_getInteger(a) (*((a).integer))
+#define MArgument_getReal(a)    (*((a).real))
+#define MArgument_getComplex(a) (*((a).cmplex))
+#define MArgument_getMTensor(a) (*((a).tensor))
+#define MArgument_getUTF8String(a) (*((a).utf8string))
+#define MArgument_setBoolean(a, v) ((*((a).boolean)) = (v))
+#define MArgument_setInteger(a, v) ((*((a).integer)) = (v))
+#define MArgument_setReal(a, v)    ((*((a).real)) = (v))
+#define MArgument_setComplex(a, v) ((*((a).cmplex)) = (v))
+#define MArgument_setMTensor(a, v) ((*((a).tensor)) = (v))
+#define MArgument_setUTF8String(a, v) ((*((a).utf8string)) = (v))
+
+typedef struct st_DataStore* DataStore;
+
+typedef struct st_WolframIOLibrary_Functions {
+   mint (*createAsynchronousTaskWithThread)(void (*)(mint, void*), void*);
+   void (*raiseAsyncEvent)(mint, char*, DataStore);
+   mbool (*asynchronousTaskAliveQ)(mint);
+   DataStore (*createDataStore)(void);
+   void (*DataStore_addInteger)(DataStore, mint);
+}* WolframIOLibrary_Functions;
+
+typedef struct st_WolframLibraryData* WolframLibraryData;
+
+struct st_WolframLibraryData {
+   int (*MTensor_new)(mint, mint, mint const*, MTensor*);
+   void (*MTensor_free)(MTensor);
+   mint (*MTensor_getType)(MTensor);
+   mint (*MTensor_getRank)(MTensor);
+   mint const* (*MTensor_getDimensions)(MTensor);
+   mint* (*MTensor_getIntegerData)(MTensor);
+   mreal* (*MTensor_getRealData)(MTensor);
+   mcomplex* (*MTensor_getComplexData)(MTensor);
+   MLINK (*getMathLink)(WolframLibraryData);
+   int (*processMathLink)(MLINK);
+   mint (*AbortQ)(void);
+   int (*registerLibraryExpressionManager)(const char*, void (*)(WolframLibraryData, mbool, mint));
+   int (*unregisterLibraryExpressionManager)(const char*);
+   WolframIOLibrary_Functions ioLibraryFunctions;
+};
+
+/// library data whose kernel link discards all messages
+WolframLibraryData mock_library_data();
+
+#endif
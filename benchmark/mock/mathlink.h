@@ -0,0 +1,78 @@
+// ====================================================================
+// This file is part of tsil-mma.
+//
+// tsil-mma is licenced under the GNU General Public License (GNU GPL)
+// version 3.
+// ====================================================================
+
+#ifndef TSIL_MMA_MOCK_MATHLINK_H
+#define TSIL_MMA_MOCK_MATHLINK_H
+
+/**
+ * In-process replacement of the MathLink API, which allows to call the
+ * LinkObject functions of librarylink.cpp without Mathematica.  Only
+ * the functions used by librarylink.cpp are provided.
+ *
+ * The link reads its arguments from a prepared list of tokens and
+ * counts the written tokens without storing them, so the measured time
+ * is spent in librarylink.cpp and not in the mock.
+ */
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#define RETURNPKT 3
+
+struct MLink {
+   struct Token {
+      enum class Kind { Function, Real, Integer, String };
+      Kind kind{Kind::Real};
+      std::string name;    ///< head of a function or string
+      long double real{0};
+      long argc{0};        ///< number of arguments of a function
+   };
+
+   std::vector<Token> input;    ///< expression to be read
+   std::size_t position{0};     ///< next token to be read
+   std::size_t written{0};      ///< number of written tokens
+
+   /// starts reading the input from the beginning
+   void rewind() { position = 0; written = 0; }
+
+   MLink& function(const std::string& head, long argc);
+   MLink& real(long double);
+   MLink& integer(int);
+   MLink& string(const std::string&);
+};
+
+typedef MLink* MLINK;
+typedef long long mlint64;
+
+extern "C" {
+
+int MLPutSymbol(MLINK, const char*);
+int MLPutString(MLINK, const char*);
+int MLPutInteger(MLINK, int);
+int MLPutReal(MLINK, double);
+int MLPutReal64(MLINK, double);
+int MLPutReal128(MLINK, long double);
+int MLPutFunction(MLINK, const char*, int);
+int MLPutUTF8Symbol(MLINK, const unsigned char*, int);
+int MLPutUTF8String(MLINK, const unsigned char*, int);
+int MLPutReal64Array(MLINK, const double*, const int*, const char**, int);
+int MLPutReal128Array(MLINK, const long double*, const int*, const char**, int);
+int MLGetReal64(MLINK, double*);
+int MLGetReal128(MLINK, long double*);
+int MLGetInteger(MLINK, int*);
+int MLGetInteger64(MLINK, mlint64*);
+int MLGetString(MLINK, const char**);
+void MLReleaseString(MLINK, const char*);
+int MLCheckFunction(MLINK, const char*, long*);
+int MLTestHead(MLINK, const char*, int*);
+int MLNewPacket(MLINK);
+int MLNextPacket(MLINK);
+
+} // extern "C"
+
+#endif
@@ -0,0 +1,203 @@
+// ====================================================================
+// This file is part of tsil-mma.
+//
+// tsil-mma is licenced under the GNU General Public License (GNU GPL)
+// version 3.
+// ====================================================================
+
+#include "mathlink.h"
+#include "WolframLibrary.h"
+
+namespace {
+
+/// returns the next token if it is of the given kind, or nullptr
+const MLink::Token* next(MLINK link, MLink::Token::Kind kind)
+{
+   if (link->position >= link->input.size() ||
+       link->input[link->position].kind != kind) {
+      return nullptr;
+   }
+
+   return &link->input[link->position++];
+}
+
+/// reads a number, where integers are converted to reals
+template <class T>
+int get_number(MLINK link, T* val)
+{
+   const MLink::Token* token = next(link, MLink::Token::Kind::Real);
+
+   if (!token) {
+      token = next(link, MLink::Token::Kind::Integer);
+   }
+
+   if (!token) {
+      return 0;
+   }
+
+   *val = static_cast<T>(token->real);
+
+   return 1;
+}
+
+int put(MLINK link)
+{
+   link->written++;
+   return 1;
+}
+
+int put_array(MLINK link, const int* dims, int depth)
+{
+   for (int i = 0; i < depth; i++) {
+      link->written += dims[i];
+   }
+   return 1;
+}
+
+/// link of the kernel, which discards everything
+MLink kernel_link;
+
+MLINK get_math_link(WolframLibraryData)
+{
+   kernel_link.rewind();
+   return &kernel_link;
+}
+
+int process_math_link(MLINK)
+{
+   return 1;
+}
+
+} // anonymous namespace
+
+/******************************************************************/
+
+MLink& MLink::function(const std::string& head, long argc)
+{
+   Token t;
+   t.kind = Token::Kind::Function;
+   t.name = head;
+   t.argc = argc;
+   input.push_back(t);
+   return *this;
+}
+
+MLink& MLink::real(long double val)
+{
+   Token t;
+   t.kind = Token::Kind::Real;
+   t.real = val;
+   input.push_back(t);
+   return *this;
+}
+
+MLink& MLink::integer(int val)
+{
+   Token t;
+   t.kind = Token::Kind::Integer;
+   t.real = val;
+   input.push_back(t);
+   return *this;
+}
+
+MLink& MLink::string(const std::string& str)
+{
+   Token t;
+   t.kind = Token::Kind::String;
+   t.name = str;
+   input.push_back(t);
+   return *this;
+}
+
+/******************************************************************/
+
+WolframLibraryData mock_library_data()
+{
+   static st_WolframLibraryData data{};
+   data.getMathLink = get_math_link;
+   data.processMathLink = process_math_link;
+   return &data;
+}
+
+/******************************************************************/
+
+extern "C" {
+
+int MLPutSymbol(MLINK link, const char*) { return put(link); }
+int MLPutString(MLINK link, const char*) { return put(link); }
+int MLPutInteger(MLINK link, int) { return put(link); }
+int MLPutReal(MLINK link, double) { return put(link); }
+int MLPutReal64(MLINK link, double) { return put(link); }
+int MLPutReal128(MLINK link, long double) { return put(link); }
+int MLPutFunction(MLINK link, const char*, int) { return put(link); }
+int MLPutUTF8Symbol(MLINK link, const unsigned char*, int) { return put(link); }
+int MLPutUTF8String(MLINK link, const unsigned char*, int) { return put(link); }
+
+int MLPutReal64Array(MLINK link, const double*, const int* dims, const char**, int depth)
+{
+   return put_array(link, dims, depth);
+}
+
+int MLPutReal128Array(MLINK link, const long double*, const int* dims, const char**, int depth)
+{
+   return put_array(link, dims, depth);
+}
+
+int MLGetReal64(MLINK link, double* val) { return get_number(link, val); }
+int MLGetReal128(MLINK link, long double* val) { return get_number(link, val); }
+int MLGetInteger(MLINK link, int* val) { return get_number(link, val); }
+int MLGetInteger64(MLINK link, mlint64* val) { return get_number(link, val); }
+
+int MLGetString(MLINK link, const char** str)
+{
+   const MLink::Token* token = next(link, MLink::Token::Kind::String);
+
+   if (!token) {
+      return 0;
+   }
+
+   *str = token->name.c_str();
+
+   return 1;
+}
+
+void MLReleaseString(MLINK, const char*) {}
+
+int MLCheckFunction(MLINK link, const char* head, long* argc)
+{
+   if (link->position >= link->input.size()) {
+      return 0;
+   }
+
+   const auto& token = link->input[link->position];
+
+   if (token.kind != MLink::Token::Kind::Function || token.name != head) {
+      return 0;
+   }
+
+   link->position++;
+   *argc = token.argc;
+
+   return 1;
+}
+
+int MLTestHead(MLINK link, const char* head, int* argc)
+{
+   long n = 0;
+   const int ok = MLCheckFunction(link, head, &n);
+   *argc = static_cast<int>(n);
+   return ok;
+}
+
+int MLNewPacket(MLINK link)
+{
+   link->position = link->input.size();
+   return 1;
+}
+
+int MLNextPacket(MLINK)
+{
+   return RETURNPKT;
+}
+
+} // extern "C"
@@ -0,0 +1,48 @@
+(* Measures the time per call of the single-integral functions for
+   machine-precision arguments, which are passed as native LibraryLink
+   arguments, and for arbitrary-precision arguments, which are passed
+   through a LinkObject (the only interface before the native
+   functions had been added).
+   Run from the build directory:
+
+     math -run '<< "../benchmark/scalar.m"'
+*)
+
+Get[FileNameJoin[{DirectoryName[$InputFileName], "..", "src", "LibraryLink.m"}]];
+
+(* replace .so by .dylib on MacOS *)
+TSILInitialize[FileNameJoin[{"src", "LibraryLink.so"}]];
+
+(* measure the call overhead, not the cache *)
+TSILSetCacheSize[0];
+
+x  = 1.;
+y  = 2.;
+z  = 3.;
+qq = 1.;
+
+nCalls = 10000;
+svals  = Table[10. + 0.1 k I, {k, nCalls}];
+
+(* time per call in microseconds *)
+timePerCall[f_, prec_] :=
+    With[{args = If[prec === MachinePrecision, {x, y, z, qq, svals}, N[{x, y, z, qq, svals}, prec]]},
+         10^6 First[AbsoluteTiming[f[Sequence @@ args]]]/nCalls
+    ];
+
+benchmarks = {
+    {"A",   Function[{x, y, z, qq, ss}, Do[TSILA[x + Im[s], qq], {s, ss}]]},
+    {"B",   Function[{x, y, z, qq, ss}, Do[TSILB[x, y, s, qq], {s, ss}]]},
+    {"I",   Function[{x, y, z, qq, ss}, Do[TSILI[x + Im[s], y, z, qq], {s, ss}]]},
+    {"Ip3", Function[{x, y, z, qq, ss}, Do[TSILIp3[x + Im[s], y, z, qq], {s, ss}]]}
+};
+
+rows = {#[[1]], timePerCall[#[[2]], 20], timePerCall[#[[2]], MachinePrecision]}& /@ benchmarks;
+
+Print["Number of calls: ", nCalls];
+Print[TableForm[
+    Append[#, #[[2]]/#[[3]]]& /@ rows,
+    TableHeadings -> {None, {"function", "LinkObject / us", "native / us", "speedup"}}
+]];
+
+TSILSetCacheSize[64 1024^2];
@@ -0,0 +1,41 @@
+(* Measures the scaling of TSILEvaluateBatch with the number of threads.
+   Run from the build directory:
+
+     math -run '<< "../benchmark/threads.m"'
+*)
+
+Get[FileNameJoin[{DirectoryName[$InputFileName], "..", "src", "LibraryLink.m"}]];
+
+(* replace .so by .dylib on MacOS *)
+TSILInitialize[FileNameJoin[{"src", "LibraryLink.so"}]];
+
+(* mass scan with points near the thresholds s = (Sqrt[x] + Sqrt[y])^2,
+   which take more ODE steps than the others *)
+x  = 1;
+y  = 2;
+z  = 3;
+u  = 4;
+v  = 5;
+qq = 1;
+
+pars = Join[
+    Table[{x, y, z, u, v, s, qq}, {s, 0.1, 30, 0.1}],
+    Table[{x, y, z, u, v, (Sqrt[x] + Sqrt[z])^2 + d, qq}, {d, -0.01, 0.01, 0.0002}]
+];
+
+maxThreads = $ProcessorCount;
+
+timing[n_] := (
+    TSILSetNumberOfThreads[n];
+    First @ AbsoluteTiming[TSILEvaluateBatch[pars]]
+);
+
+times = timing /@ Range[maxThreads];
+
+Print["Number of points: ", Length[pars]];
+Print[TableForm[
+    Transpose[{Range[maxThreads], times, First[times]/times, First[times]/times/Range[maxThreads]}],
+    TableHeadings -> {None, {"threads", "time / s", "speedup", "efficiency"}}
+]];
+
+TSILSetNumberOfThreads[Automatic];
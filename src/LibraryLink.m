@@ -5,14 +5,292 @@ TSILInitialize::usage = "Loads the TSIL LibraryLink.  After
 Usage:
 
   TSILInitialize[libName];
+  TSILInitialize[libName, libNameDouble];
 
 Arguments:
 
  - libName - The path to the TSIL LibraryLink, 'LibraryLink.so'
+ - libNameDouble - The path to the double-precision variant,
+   'LibraryLinkDouble.so' (optional, see $TSILPrecision)
 ";
+$TSILPrecision::usage = "Selects the variant of the TSIL LibraryLink
+that is called:
+
+ - \"Default\": the library built with the TSIL_SIZE of the main TSIL
+   build (default)
+ - \"Double\": the double-precision variant, which must be passed as
+   2nd argument to TSILInitialize
+ - \"Adaptive\": TSILEvaluate and TSILEvaluateBatch evaluate each
+   point with the double-precision variant first and re-evaluate it
+   with the \"Default\" variant if the estimated relative error
+   exceeds $TSILAdaptiveTolerance.  All other functions use the
+   \"Default\" variant.  The results are returned in machine
+   precision, the output format \"Real128\" always uses the
+   \"Default\" variant.  See TSILEscalationStatistics.
+
+The variant can be selected for a single call with
+
+  Block[{$TSILPrecision = \"Double\"}, TSILEvaluate[x, y, z, u, v, s, qq]]
+
+Sessions use the variant that was selected when they were created.
+The number of threads and the cache are set for each variant
+separately.";
+$TSILAdaptiveTolerance::usage = "Relative error estimate above which
+a point is re-evaluated with the \"Default\" variant if
+$TSILPrecision = \"Adaptive\" (default: 10^-10).  The error estimate
+grows near the thresholds and pseudo-thresholds of s and with the
+ratio of the largest to the smallest non-zero mass.";
+TSILEscalationStatistics::usage = "Returns an association with the
+number of points evaluated with $TSILPrecision = \"Adaptive\", the
+number of escalated points, which were re-evaluated with the
+\"Default\" variant, and the escalated fraction.";
+TSILResetEscalationStatistics::usage = "Resets the counters of
+TSILEscalationStatistics.";
 
 TSILEvaluate::usage = "Evaluate all integral functions. 
-Parameters: x, y, z, u, v, s, Q^2";
+Parameters: x, y, z, u, v, s, Q^2
+
+As TSIL supports only real s, the integral functions are evaluated at
+Re(s).
+
+An optional 8th argument selects the output parameters to be
+calculated and returned, e.g.
+
+  TSILEvaluate[x, y, z, u, v, s, qq, {Mxyzuv, Uzxyv, Ax}]
+
+Options:
+
+ - \"OutputFormat\" -> \"Rules\" (default): list of rules
+   parameter -> value
+ - \"OutputFormat\" -> \"Real64\": packed array of complex machine
+   numbers, ordered as TSILResultNames (or as the selected parameters)
+ - \"OutputFormat\" -> \"Real128\": as \"Real64\", but with 128-bit
+   numbers (not packed)
+";
+TSILResultNames::usage = "List of the output parameters of
+TSILEvaluate in the order of the array returned for
+\"OutputFormat\" -> \"Real64\" or \"Real128\" and by
+TSILEvaluateBatch and TSILEvaluateSweep.";
+TSILResultIndex::usage = "Association from the output parameters of
+TSILEvaluate to their position in TSILResultNames.
+
+Example:
+
+  TSILEvaluate[x, y, z, u, v, s, qq, \"OutputFormat\" -> \"Real64\"][[TSILResultIndex[Tvyz]]]
+";
+TSILEvaluateMany::usage = "Evaluates a list of integral functions.
+Integrals that are not known analytically are calculated with as few
+numerical integrations as possible, by placing several of them into
+one TSIL evaluation.
+
+Usage:
+
+  TSILEvaluateMany[{TSILU[x, y, z, u, s, qq], TSILT[x, y, z, s, qq], ...}]
+  TSILEvaluateMany[Hold[{...}]]
+
+The list must be given explicitly or wrapped in Hold, so that the
+integral functions are not evaluated one by one.";
+TSILEvaluateMany::args = "`1` is not a list of integral functions with numeric arguments.";
+TSILFindPole::usage = "Finds the complex pole s of a propagator,
+s = m2 + c1 F1(s) + c2 F2(s) + ..., where the Fk are integral
+functions.  As TSIL supports only real s, the integral functions are
+evaluated at Re(s).  The real part is iterated inside the library with
+a fixed-point step, followed by secant steps.
+
+Usage:
+
+  TSILFindPole[m2, {{c1, TSILB[x, y, s, qq]}, {c2, TSILM[x, y, z, u, v, s]}, ...}, s]
+
+The symbol s marks the argument that is iterated and must not have a
+value.  Returns an association with the pole (\"Pole\"), whether the
+iteration converged (\"Converged\"), the number of iterations
+(\"Iterations\") and the list of {s, residual} of all iterations
+(\"History\").
+
+Options:
+
+ - \"Tolerance\" -> 10^-12: relative tolerance of Re(s)
+ - MaxIterations -> 100: maximum number of iterations
+";
+TSILFindPole::args = "`1` is not a list of {coefficient, integral function} pairs.";
+TSILRescale::usage = "Transports results of TSILEvaluate or
+TSILSessionEvaluate from the renormalization scale Q^2 to a new scale
+Q'^2, using the analytic dependence of the integral functions on
+log(Q^2), without a new numerical integration.
+
+Usage:
+
+  res = TSILEvaluate[x, y, z, u, v, s, qq];
+  TSILRescale[x, y, z, u, v, s, qq, res, qqNew]
+
+The results can be given as list of rules (all or selected output
+parameters) or as array of the 32 values ordered as TSILResultNames,
+as returned for \"OutputFormat\" -> \"Real64\".  The result has the
+same form.
+
+As in TSILEvaluate, the results belong to Re(s): Im(s) is ignored.";
+TSILEvaluateBatch::usage = "Evaluate all integral functions for a
+list of parameter points in machine precision.
+Parameters: {{x, y, z, u, v, s, Q^2}, ...}
+Returns a packed N x 32 complex array, where the columns are ordered
+as TSILResultNames.
+The points are distributed over TSILGetNumberOfThreads[] threads.
+They are evaluated in chunks of about 0.1 seconds, between which the
+library checks for an abort.  If the evaluation is aborted, the rows
+of the points finished so far are returned.";
+TSILEvaluateBatch::aborted = "Aborted after `1` of `2` points, the finished points are returned.";
+TSILSubmit::usage = "Starts the evaluation of all integral functions
+for a list of parameter points in machine precision in the background
+and returns a TSILTask handle immediately.
+Parameters: {{x, y, z, u, v, s, Q^2}, ...}
+The points are evaluated in chunks of \"ChunkSize\" points (default:
+8 TSILGetNumberOfThreads[]), each distributed over the threads, while
+the kernel remains free for other computations.  The finished chunks
+are fetched with TSILPoll and TSILCollect.  With the option
+\"ChunkFunction\" -> f, f[first, n] is called when the n points
+starting at index first have been evaluated.
+
+Usage:
+
+  h = TSILSubmit[pars];
+  (* ... other computations ... *)
+  res = TSILCollect[h];
+";
+TSILPoll::usage = "TSILPoll[h] returns the points of the TSILTask h
+which have been evaluated since the last call of TSILPoll, without
+waiting, as an association:
+
+ - \"Results\": N x 32 complex array of the new points
+ - \"FirstIndex\": index of the first new point in the submitted list
+ - \"Completed\": number of points returned so far
+ - \"Total\": number of submitted points
+ - \"Finished\": whether the task has finished";
+TSILCollect::usage = "TSILCollect[h] waits until the TSILTask h has
+finished and returns the points not yet returned by TSILPoll as N x 32
+complex array.  If TSILPoll has not been called, the result is the
+same as of TSILEvaluateBatch.  The task is released afterwards, also
+if the evaluation fails or the wait is aborted.";
+TSILCancel::usage = "TSILCancel[h] stops the TSILTask h after the
+current chunk and releases its results.";
+TSILTask::usage = "Head of the task handles returned by TSILSubmit.";
+TSILConnect::usage = "TSILConnect[] switches to client mode, where
+TSILEvaluateBatch is evaluated by a running tsil-mma-server, which
+shares its thread pool and result cache between all connected kernels
+and evaluates their requests together.  The server listens on the
+socket $TSIL_MMA_SOCKET or /tmp/tsil-mma-<uid>.sock by default.
+TSILConnect[socket] connects to the given socket.  Returns the socket.
+In client mode the precision of the server is used, independent of
+$TSILPrecision.";
+TSILDisconnect::usage = "Closes the connection to tsil-mma-server and
+leaves the client mode.";
+$TSILServer::usage = "Socket of the tsil-mma-server TSILEvaluateBatch
+is sent to, or None (default) if the points are evaluated by the
+kernel.  Set by TSILConnect and TSILDisconnect.";
+TSILEvaluateSweep::usage = "Evaluate all integral functions for fixed
+masses and Q^2 at a list of values of s in machine precision.
+Parameters: x, y, z, u, v, {s1, s2, ...}, Q^2
+Returns a packed N x 32 complex array, where the columns are ordered
+as TSILResultNames.
+The masses are set up once per thread and each distinct value of
+Re(s) is evaluated once.  As in TSILEvaluate, the results belong to
+Re(s).";
+TSILSessionCreate::usage = "Creates a session for fixed masses and
+Q^2, in which the parameter setup of TSIL is done once and reused by
+all evaluations with TSILSessionEvaluate.  Only this setup is saved:
+each evaluation still solves the differential equations from scratch.
+The session is released
+when the returned TSILSession expression is no longer referenced.
+
+Usage:
+
+  h = TSILSessionCreate[x, y, z, u, v, qq];
+";
+TSILSessionEvaluate::usage = "Evaluates all integral functions of a
+session at s.  An optional 3rd argument selects the output parameters
+to be returned.
+
+Usage:
+
+  TSILSessionEvaluate[h, s]
+  TSILSessionEvaluate[h, s, {Mxyzuv, Uzxyv, Ax}]
+";
+TSILSession::usage = "Head of the session handles returned by
+TSILSessionCreate.";
+TSILSetNumberOfThreads::usage = "Sets the number of threads used by
+TSILEvaluateBatch and TSILEvaluateSweep and returns the new number of
+threads.
+
+Usage:
+
+  TSILSetNumberOfThreads[n];
+  TSILSetNumberOfThreads[Automatic]; (* one thread per core *)
+";
+TSILGetNumberOfThreads::usage = "Returns the number of threads used by
+TSILEvaluateBatch and TSILEvaluateSweep.";
+TSILCacheStatistics::usage = "Returns an association with the
+number of hits and misses of the result cache, the number of cached
+entries, the estimated memory of the entries in bytes, the memory
+limit in bytes and the number of hits on entries calculated at a
+different scale or Q^2 (see TSILSetCacheNormalization).";
+TSILSetCacheNormalization::usage = "TSILSetCacheNormalization[True]
+normalizes the keys of the result cache: the masses and s are divided
+by the largest of them and Q^2 is set to 1.  Points which differ only
+by an overall scale or by Q^2 then share one evaluation.  The results
+are transported back using the homogeneity of the integral functions
+and their analytic dependence on log(Q^2), which may cost a few digits
+of precision if the scales differ by many orders of magnitude.
+TSILSetCacheNormalization[False] (default) disables the normalization.";
+TSILStatistics::usage = "Returns an association with statistics of
+the calculations of each integral function since the last call of
+TSILResetStatistics[]:
+
+ - \"Calls\": number of requested values
+ - \"CacheHits\": values taken from the result cache
+ - \"Analytic\": values calculated analytically
+ - \"ODE\": values calculated with TSIL_Evaluate (fallbacks if the
+   function is not known analytically at the given arguments)
+ - \"FallbackRate\": ODE/(Analytic + ODE)
+ - \"AnalyticSeconds\": time of the analytic calculations, including
+   failed attempts
+ - \"ODESeconds\": time of TSIL_Evaluate, shared equally by the
+   values calculated in one run
+
+\"Evaluate\" counts the evaluations of all functions by TSILEvaluate,
+TSILEvaluateBatch, TSILEvaluateSweep and TSILSessionEvaluate.  Only
+functions that have been called are listed.";
+TSILResetStatistics::usage = "Resets the counters of TSILStatistics.";
+TSILTraceStatistics::usage = "Returns the latency histograms of the
+library entry points since the last call of TSILResetTracing[] as an
+association <|\"enabled\" -> ..., \"functions\" -> ...|>.  For each
+entry point the phases \"parse\" (reading the arguments), \"compute\"
+and \"marshal\" (writing the results) are listed with the number of
+calls, the total, minimal and maximal time in nanoseconds and the
+non-empty buckets {lower bound in ns, count} of a histogram with
+logarithmic bucket widths.  TSILTraceStatistics[file] writes the
+statistics as JSON to the given file.  The histograms are only
+recorded if tsil-mma has been configured with
+-DTSIL_MMA_ENABLE_TRACING=ON, otherwise \"enabled\" is False.";
+TSILResetTracing::usage = "Removes all latency histograms of
+TSILTraceStatistics.";
+TSILSetCacheSize::usage = "Sets the memory limit of the result cache
+in bytes.  If the limit is exceeded, the least recently used entries
+are removed.  TSILSetCacheSize[0] disables the cache.";
+TSILClearCache::usage = "Removes all entries from the result cache and
+resets the hit and miss counters.";
+TSILSetResultStore::usage = "TSILSetResultStore[file] opens a
+persistent result store in the given file, which is created if it
+does not exist.  Results which are not found in the result cache are
+looked up in the store, and new results are appended to it.  The file
+can be shared by several kernels on one node, e.g. by the subkernels
+of ParallelMap, and it keeps the results between sessions.
+TSILSetResultStore[file, maxBytes] sets the capacity of a newly
+created file (default: 2^30 bytes).  When the capacity is reached, no
+more results are stored until the file is compacted with the
+tsil-mma-store program.  TSILSetResultStore[None] closes the store.";
+TSILResultStoreStatistics::usage = "Returns the number of hits, misses
+and rejected results (stored while the file was full), the number of
+entries and the size and the capacity of the persistent result store
+in bytes.";
 TSILA::usage = "A(x,Q^2)";
 TSILAp::usage = "Ap(x,Q^2)";
 TSILAeps::usage = "Aeps(x,Q^2)";
@@ -43,7 +321,28 @@ TSILV::usage = "U(x,y,z,u,s,Q^2)";
   Ixyv, Izuv,
   Ax, Ay, Az, Au, Av };
 
+(* order of the output parameters in arrays *)
+TSILResultNames = {
+    Mxyzuv,
+    Uzxyv, Uuyxv, Uxzuv, Uyuzv,
+    Tvyz, Tuxv, Tyzv, Txuv, Tzyv, Tvxu,
+    TBARvyz, TBARuxv, TBARyzv, TBARxuv, TBARzyv, TBARvxu,
+    Svyz, Suxv,
+    Bxz, Byu,
+    Vzxyv, Vuyxv, Vxzuv, Vyuzv,
+    Ax, Ay, Az, Au, Av,
+    Ixyv, Izuv };
+
+$TSILPrecision = "Default";
+
+$TSILServer = None;
+
+$TSILAdaptiveTolerance = 10^-10;
+
+TSILResultIndex = AssociationThread[TSILResultNames -> Range[Length[TSILResultNames]]];
+
 TSIL::nonum = "Error: `1` is not a numeric input value!";
+TSIL::novariant = "Error: the `1` variant of the TSIL LibraryLink has not been loaded!";
 TSIL::error = "`1`";
 TSIL::info  = "`1`";
 TSILErrorMessage[s_] := Message[TSIL::error, s];
@@ -51,65 +350,415 @@ TSILInfoMessage[s_]  := Message[TSIL::info, s];
 
 Begin["`Private`"];
 
-TSILInitialize[libName_String] := (
-       TSILEvaluateLL = LibraryFunctionLoad[libName, "TSILEvaluate", LinkObject, LinkObject];
-       TSILALL        = LibraryFunctionLoad[libName, "TSILA"       , LinkObject, LinkObject];
-       TSILApLL       = LibraryFunctionLoad[libName, "TSILAp"      , LinkObject, LinkObject];
-       TSILAepsLL     = LibraryFunctionLoad[libName, "TSILAeps"    , LinkObject, LinkObject];
-       TSILBLL        = LibraryFunctionLoad[libName, "TSILB"       , LinkObject, LinkObject];
-       TSILBpLL       = LibraryFunctionLoad[libName, "TSILBp"      , LinkObject, LinkObject];
-       TSILdBdsLL     = LibraryFunctionLoad[libName, "TSILdBds"    , LinkObject, LinkObject];
-       TSILBepsLL     = LibraryFunctionLoad[libName, "TSILBeps"    , LinkObject, LinkObject];
-       TSILILL        = LibraryFunctionLoad[libName, "TSILI"       , LinkObject, LinkObject];
-       TSILIpLL       = LibraryFunctionLoad[libName, "TSILIp"      , LinkObject, LinkObject];
-       TSILIp2LL      = LibraryFunctionLoad[libName, "TSILIp2"     , LinkObject, LinkObject];
-       TSILIppLL      = LibraryFunctionLoad[libName, "TSILIpp"     , LinkObject, LinkObject];
-       TSILIp3LL      = LibraryFunctionLoad[libName, "TSILIp3"     , LinkObject, LinkObject];
-       TSILMLL        = LibraryFunctionLoad[libName, "TSILM"       , LinkObject, LinkObject];
-       TSILSLL        = LibraryFunctionLoad[libName, "TSILS"       , LinkObject, LinkObject];
-       TSILTLL        = LibraryFunctionLoad[libName, "TSILT"       , LinkObject, LinkObject];
-       TSILTbarLL     = LibraryFunctionLoad[libName, "TSILTbar"    , LinkObject, LinkObject];
-       TSILULL        = LibraryFunctionLoad[libName, "TSILU"       , LinkObject, LinkObject];
-       TSILVLL        = LibraryFunctionLoad[libName, "TSILV"       , LinkObject, LinkObject];
+TSILInitialize[libName_String] := TSILInitialize[libName, None];
+
+TSILInitialize[libName_String, libNameDouble:(_String|None)] := (
+       LoadLibrary["Default", libName];
+       If[libNameDouble =!= None, LoadLibrary["Double", libNameDouble]];
+    );
+
+(* loads the functions of a library variant into LL[variant, name] *)
+LoadLibrary[variant_, libName_String] := (
+       LL[variant, "TSILEvaluate"] = LibraryFunctionLoad[libName, "TSILEvaluate", LinkObject, LinkObject];
+       LL[variant, "TSILEvaluateArray"] = LibraryFunctionLoad[libName, "TSILEvaluateArray", LinkObject, LinkObject];
+       LL[variant, "TSILEvaluateMany"] = LibraryFunctionLoad[libName, "TSILEvaluateMany", LinkObject, LinkObject];
+       LL[variant, "TSILRescale"] = LibraryFunctionLoad[libName, "TSILRescale", LinkObject, LinkObject];
+       LL[variant, "TSILFindPole"] = LibraryFunctionLoad[libName, "TSILFindPole", LinkObject, LinkObject];
+       LL[variant, "TSILEvaluateBatch"] = LibraryFunctionLoad[libName, "TSILEvaluateBatch", {{Real, 2, "Constant"}}, {Complex, 2}];
+       LL[variant, "TSILTakePartialResults"] = LibraryFunctionLoad[libName, "TSILTakePartialResults", {}, {Complex, 2}];
+       LL[variant, "TSILConnect"] = LibraryFunctionLoad[libName, "TSILConnect", LinkObject, LinkObject];
+       LL[variant, "TSILDisconnect"] = LibraryFunctionLoad[libName, "TSILDisconnect", {}, "Void"];
+       LL[variant, "TSILRemoteEvaluateBatch"] = LibraryFunctionLoad[libName, "TSILRemoteEvaluateBatch", {{Real, 2, "Constant"}}, {Complex, 2}];
+       LL[variant, "TSILSubmit"] = LibraryFunctionLoad[libName, "TSILSubmit", {{Real, 2, "Constant"}, Integer}, Integer];
+       LL[variant, "TSILTaskStatus"] = LibraryFunctionLoad[libName, "TSILTaskStatus", {Integer}, {Integer, 1}];
+       LL[variant, "TSILPoll"] = LibraryFunctionLoad[libName, "TSILPoll", {Integer}, {Complex, 2}];
+       LL[variant, "TSILCollect"] = LibraryFunctionLoad[libName, "TSILCollect", {Integer}, {Complex, 2}];
+       LL[variant, "TSILCancelTask"] = LibraryFunctionLoad[libName, "TSILCancelTask", {Integer}, "Void"];
+       LL[variant, "TSILEstimateErrors"] = LibraryFunctionLoad[libName, "TSILEstimateErrors", {{Real, 2, "Constant"}, {Complex, 2, "Constant"}}, {Real, 1}];
+       LL[variant, "TSILEvaluateSweep"] = LibraryFunctionLoad[libName, "TSILEvaluateSweep", {{Real, 1, "Constant"}, {Complex, 1, "Constant"}}, {Complex, 2}];
+       LL[variant, "TSILSessionInit"] = LibraryFunctionLoad[libName, "TSILSessionInit", LinkObject, LinkObject];
+       LL[variant, "TSILSessionEvaluate"] = LibraryFunctionLoad[libName, "TSILSessionEvaluate", LinkObject, LinkObject];
+       LL[variant, "TSILSetNumberOfThreads"] = LibraryFunctionLoad[libName, "TSILSetNumberOfThreads", {Integer}, Integer];
+       LL[variant, "TSILGetNumberOfThreads"] = LibraryFunctionLoad[libName, "TSILGetNumberOfThreads", {}, Integer];
+       LL[variant, "TSILCacheStatistics"] = LibraryFunctionLoad[libName, "TSILCacheStatistics", {}, {Integer, 1}];
+       LL[variant, "TSILSetCacheSize"] = LibraryFunctionLoad[libName, "TSILSetCacheSize", {Integer}, Integer];
+       LL[variant, "TSILSetCacheNormalization"] = LibraryFunctionLoad[libName, "TSILSetCacheNormalization", {"Boolean"}, "Boolean"];
+       LL[variant, "TSILFunctionStatistics"] = LibraryFunctionLoad[libName, "TSILFunctionStatistics", {}, {Real, 2}];
+       LL[variant, "TSILResetStatistics"] = LibraryFunctionLoad[libName, "TSILResetStatistics", {}, "Void"];
+       LL[variant, "TSILTracing"] = LibraryFunctionLoad[libName, "TSILTracing", {}, "UTF8String"];
+       LL[variant, "TSILResetTracing"] = LibraryFunctionLoad[libName, "TSILResetTracing", {}, "Void"];
+       LL[variant, "TSILClearCache"] = LibraryFunctionLoad[libName, "TSILClearCache", {}, "Void"];
+       LL[variant, "TSILSetResultStore"] = LibraryFunctionLoad[libName, "TSILSetResultStore", LinkObject, LinkObject];
+       LL[variant, "TSILResultStoreStatistics"] = LibraryFunctionLoad[libName, "TSILResultStoreStatistics", {}, {Integer, 1}];
+       LL[variant, "TSILA"]        = LibraryFunctionLoad[libName, "TSILA"       , LinkObject, LinkObject];
+       LL[variant, "TSILAp"]       = LibraryFunctionLoad[libName, "TSILAp"      , LinkObject, LinkObject];
+       LL[variant, "TSILAeps"]     = LibraryFunctionLoad[libName, "TSILAeps"    , LinkObject, LinkObject];
+       LL[variant, "TSILB"]        = LibraryFunctionLoad[libName, "TSILB"       , LinkObject, LinkObject];
+       LL[variant, "TSILBp"]       = LibraryFunctionLoad[libName, "TSILBp"      , LinkObject, LinkObject];
+       LL[variant, "TSILdBds"]     = LibraryFunctionLoad[libName, "TSILdBds"    , LinkObject, LinkObject];
+       LL[variant, "TSILBeps"]     = LibraryFunctionLoad[libName, "TSILBeps"    , LinkObject, LinkObject];
+       LL[variant, "TSILI"]        = LibraryFunctionLoad[libName, "TSILI"       , LinkObject, LinkObject];
+       LL[variant, "TSILIp"]       = LibraryFunctionLoad[libName, "TSILIp"      , LinkObject, LinkObject];
+       LL[variant, "TSILIp2"]      = LibraryFunctionLoad[libName, "TSILIp2"     , LinkObject, LinkObject];
+       LL[variant, "TSILIpp"]      = LibraryFunctionLoad[libName, "TSILIpp"     , LinkObject, LinkObject];
+       LL[variant, "TSILIp3"]      = LibraryFunctionLoad[libName, "TSILIp3"     , LinkObject, LinkObject];
+       LL[variant, "TSILM"]        = LibraryFunctionLoad[libName, "TSILM"       , LinkObject, LinkObject];
+       LL[variant, "TSILS"]        = LibraryFunctionLoad[libName, "TSILS"       , LinkObject, LinkObject];
+       LL[variant, "TSILT"]        = LibraryFunctionLoad[libName, "TSILT"       , LinkObject, LinkObject];
+       LL[variant, "TSILTbar"]     = LibraryFunctionLoad[libName, "TSILTbar"    , LinkObject, LinkObject];
+       LL[variant, "TSILU"]        = LibraryFunctionLoad[libName, "TSILU"       , LinkObject, LinkObject];
+       LL[variant, "TSILV"]        = LibraryFunctionLoad[libName, "TSILV"       , LinkObject, LinkObject];
+       LL[variant, "TSILANative"]    = LibraryFunctionLoad[libName, "TSILANative"   , {Real, Real}, Complex];
+       LL[variant, "TSILApNative"]   = LibraryFunctionLoad[libName, "TSILApNative"  , {Real, Real}, Complex];
+       LL[variant, "TSILAepsNative"] = LibraryFunctionLoad[libName, "TSILAepsNative", {Real, Real}, Complex];
+       LL[variant, "TSILBNative"]    = LibraryFunctionLoad[libName, "TSILBNative"   , {Real, Real, Complex, Real}, Complex];
+       LL[variant, "TSILBpNative"]   = LibraryFunctionLoad[libName, "TSILBpNative"  , {Real, Real, Complex, Real}, Complex];
+       LL[variant, "TSILdBdsNative"] = LibraryFunctionLoad[libName, "TSILdBdsNative", {Real, Real, Complex, Real}, Complex];
+       LL[variant, "TSILBepsNative"] = LibraryFunctionLoad[libName, "TSILBepsNative", {Real, Real, Complex, Real}, Complex];
+       LL[variant, "TSILINative"]    = LibraryFunctionLoad[libName, "TSILINative"   , {Real, Real, Real, Real}, Complex];
+       LL[variant, "TSILIpNative"]   = LibraryFunctionLoad[libName, "TSILIpNative"  , {Real, Real, Real, Real}, Complex];
+       LL[variant, "TSILIp2Native"]  = LibraryFunctionLoad[libName, "TSILIp2Native" , {Real, Real, Real, Real}, Complex];
+       LL[variant, "TSILIppNative"]  = LibraryFunctionLoad[libName, "TSILIppNative" , {Real, Real, Real, Real}, Complex];
+       LL[variant, "TSILIp3Native"]  = LibraryFunctionLoad[libName, "TSILIp3Native" , {Real, Real, Real, Real}, Complex];
+       LL[variant, "TSILMNative"]    = LibraryFunctionLoad[libName, "TSILMNative"   , {Real, Real, Real, Real, Real, Complex}, Complex];
+       LL[variant, "TSILSNative"]    = LibraryFunctionLoad[libName, "TSILSNative"   , {Real, Real, Real, Complex, Real}, Complex];
+       LL[variant, "TSILTNative"]    = LibraryFunctionLoad[libName, "TSILTNative"   , {Real, Real, Real, Complex, Real}, Complex];
+       LL[variant, "TSILTbarNative"] = LibraryFunctionLoad[libName, "TSILTbarNative", {Real, Real, Real, Complex, Real}, Complex];
+       LL[variant, "TSILUNative"]    = LibraryFunctionLoad[libName, "TSILUNative"   , {Real, Real, Real, Real, Complex, Real}, Complex];
+       LL[variant, "TSILVNative"]    = LibraryFunctionLoad[libName, "TSILVNative"   , {Real, Real, Real, Real, Complex, Real}, Complex];
     );
 
-TSILEvaluate[x_?NumericQ, y_?NumericQ, z_?NumericQ, u_?NumericQ, v_?NumericQ, s_?NumericQ, qq_?NumericQ] :=
-    TSILEvaluateLL[N @ {x, y, z, u, v, Re[s], Im[s], qq}];
+(* function of the library variant selected by $TSILPrecision *)
+LL[name_String] := LL[$TSILPrecision, name];
+
+(* functions without an adaptive implementation *)
+LL["Adaptive", name_String] := LL["Default", name];
+
+LL[variant_, name_String] := (Message[TSIL::novariant, variant]; $Failed&);
+
+(* number of points evaluated adaptively and number of escalated points *)
+EscalationCounts = {0, 0};
+
+TSILEscalationStatistics[] :=
+    <| "Points" -> EscalationCounts[[1]], "Escalated" -> EscalationCounts[[2]],
+       "Fraction" -> If[EscalationCounts[[1]] == 0, 0., N[EscalationCounts[[2]]/EscalationCounts[[1]]]] |>;
+
+TSILResetEscalationStatistics[] := (EscalationCounts = {0, 0};);
+
+(* evaluates a N x 8 matrix of parameter points with the "Double"
+   variant and re-evaluates the points with an estimated relative
+   error above $TSILAdaptiveTolerance with the "Default" variant *)
+EvaluateAdaptive[pars_] :=
+    Module[{res, errs, escalated},
+           res = Replace[LL["Double", "TSILEvaluateBatch"][pars], _LibraryFunctionError -> $Failed];
+           If[res === $Failed, Return[$Failed]];
+           errs = LL["Double", "TSILEstimateErrors"][pars, res];
+           If[!VectorQ[errs, NumericQ], Return[$Failed]];
+           escalated = Pick[Range[Length[errs]], UnitStep[N[$TSILAdaptiveTolerance] - errs], 0];
+           If[escalated =!= {},
+              res[[escalated]] = Replace[LL["Default", "TSILEvaluateBatch"][pars[[escalated]]], _LibraryFunctionError -> $Failed];
+              If[!ArrayQ[res, 2, NumericQ], Return[$Failed]]
+           ];
+           EscalationCounts += {Length[pars], Length[escalated]};
+           res
+    ];
+
+(* index of the output parameters by name *)
+ResultIndexByName = AssociationThread[SymbolName /@ TSILResultNames -> Range[Length[TSILResultNames]]];
+
+Options[TSILEvaluate] = { "OutputFormat" -> "Rules" };
+
+TSILEvaluate[x_?NumericQ, y_?NumericQ, z_?NumericQ, u_?NumericQ, v_?NumericQ, s_?NumericQ, qq_?NumericQ, opts:(_Rule|_RuleDelayed)...] :=
+    EvaluateAll[N @ {x, y, z, u, v, Re[s], Im[s], qq}, OptionValue[TSILEvaluate, {opts}, "OutputFormat"]];
+
+TSILEvaluate[x_?NumericQ, y_?NumericQ, z_?NumericQ, u_?NumericQ, v_?NumericQ, s_?NumericQ, qq_?NumericQ, wanted:{___Symbol}, opts:(_Rule|_RuleDelayed)...] :=
+    EvaluateSelected[N @ {x, y, z, u, v, Re[s], Im[s], qq}, SymbolName /@ wanted, OptionValue[TSILEvaluate, {opts}, "OutputFormat"]];
+
+OutputBits["Real64"]  = 64;
+OutputBits["Real128"] = 128;
+
+(* converts {{Re, Im}, ...} to {Complex[Re, Im], ...} *)
+ToComplexArray[a_List] := a[[All, 1]] + I a[[All, 2]];
+ToComplexArray[a_] := a;
+
+EvaluateAll[pars_, fmt:("Rules"|"Real64")] /; $TSILPrecision === "Adaptive" :=
+    With[{res = EvaluateAdaptive[{pars}]},
+         If[res === $Failed, $Failed,
+            If[fmt === "Rules", Thread[TSILResultNames -> First[res]], First[res]]]
+    ];
+
+EvaluateSelected[pars_, names_, fmt:("Rules"|"Real64")] /; $TSILPrecision === "Adaptive" &&
+                                                          VectorQ[Lookup[ResultIndexByName, names], IntegerQ] :=
+    With[{res = EvaluateAdaptive[{pars}], idx = Lookup[ResultIndexByName, names]},
+         If[res === $Failed, $Failed,
+            If[fmt === "Rules", Thread[TSILResultNames[[idx]] -> First[res][[idx]]], First[res][[idx]]]]
+    ];
+
+EvaluateAll[pars_, "Rules"] := LL["TSILEvaluate"][pars];
+
+EvaluateAll[pars_, fmt:("Real64"|"Real128")] :=
+    ToComplexArray @ LL["TSILEvaluateArray"][pars, OutputBits[fmt]];
+
+EvaluateSelected[pars_, names_, "Rules"] := LL["TSILEvaluate"][pars, names];
+
+EvaluateSelected[pars_, names_, fmt:("Real64"|"Real128")] :=
+    ToComplexArray @ LL["TSILEvaluateArray"][pars, OutputBits[fmt], names];
+
+SetAttributes[ToIntegralSpec, HoldFirst];
+
+(* converts an integral function to {name, {arguments}} *)
+ToIntegralSpec[TSILA[x_, qq_]] := {"A", N @ {x, qq}};
+ToIntegralSpec[TSILAp[x_, qq_]] := {"Ap", N @ {x, qq}};
+ToIntegralSpec[TSILAeps[x_, qq_]] := {"Aeps", N @ {x, qq}};
+ToIntegralSpec[TSILB[x_, y_, s_, qq_]] := {"B", N @ {x, y, Re[s], Im[s], qq}};
+ToIntegralSpec[TSILBp[x_, y_, s_, qq_]] := {"Bp", N @ {x, y, Re[s], Im[s], qq}};
+ToIntegralSpec[TSILdBds[x_, y_, s_, qq_]] := {"dBds", N @ {x, y, Re[s], Im[s], qq}};
+ToIntegralSpec[TSILBeps[x_, y_, s_, qq_]] := {"Beps", N @ {x, y, Re[s], Im[s], qq}};
+ToIntegralSpec[TSILI[x_, y_, z_, qq_]] := {"I", N @ {x, y, z, qq}};
+ToIntegralSpec[TSILIp[x_, y_, z_, qq_]] := {"Ip", N @ {x, y, z, qq}};
+ToIntegralSpec[TSILIp2[x_, y_, z_, qq_]] := {"Ip2", N @ {x, y, z, qq}};
+ToIntegralSpec[TSILIpp[x_, y_, z_, qq_]] := {"Ipp", N @ {x, y, z, qq}};
+ToIntegralSpec[TSILIp3[x_, y_, z_, qq_]] := {"Ip3", N @ {x, y, z, qq}};
+ToIntegralSpec[TSILM[x_, y_, z_, u_, v_, s_]] := {"M", N @ {x, y, z, u, v, Re[s], Im[s]}};
+ToIntegralSpec[TSILS[x_, y_, z_, s_, qq_]] := {"S", N @ {x, y, z, Re[s], Im[s], qq}};
+ToIntegralSpec[TSILT[x_, y_, z_, s_, qq_]] := {"T", N @ {x, y, z, Re[s], Im[s], qq}};
+ToIntegralSpec[TSILTbar[x_, y_, z_, s_, qq_]] := {"Tbar", N @ {x, y, z, Re[s], Im[s], qq}};
+ToIntegralSpec[TSILU[x_, y_, z_, u_, s_, qq_]] := {"U", N @ {x, y, z, u, Re[s], Im[s], qq}};
+ToIntegralSpec[TSILV[x_, y_, z_, u_, s_, qq_]] := {"V", N @ {x, y, z, u, Re[s], Im[s], qq}};
+
+SetAttributes[TSILEvaluateMany, HoldFirst];
+
+TSILEvaluateMany[Hold[integrals_List]] := TSILEvaluateMany[integrals];
+
+TSILEvaluateMany[integrals_List] :=
+    Module[{specs = ToIntegralSpec /@ Unevaluated[integrals]},
+           If[MatchQ[specs, {{_String, {___Real}}...}],
+              LL["TSILEvaluateMany"][specs],
+              Message[TSILEvaluateMany::args, HoldForm[integrals]];
+              $Failed
+           ]
+    ];
+
+Options[TSILFindPole] = { "Tolerance" -> 10^-12, MaxIterations -> 100 };
+
+TSILFindPole[m2_?NumericQ, terms:{{_, _}...}, s_Symbol, opts:OptionsPattern[]] :=
+    Module[{coeffs = N[terms[[All, 1]]], specs, res},
+           (* the iterated argument s is set by the library *)
+           specs = (ToIntegralSpec @@ (Hold[#] /. s -> 0))& /@ terms[[All, 2]];
+           If[!MatchQ[specs, {{_String, {___Real}}...}] || !VectorQ[coeffs, NumericQ],
+              Message[TSILFindPole::args, terms];
+              Return[$Failed]
+           ];
+           res = LL["TSILFindPole"][N @ {Re[m2], Im[m2]}, Flatten[{Re[#], Im[#]}& /@ coeffs], specs,
+                                N @ {OptionValue["Tolerance"], OptionValue[MaxIterations]}];
+           If[res === $Failed, $Failed,
+              <| "Pole" -> res[[1]], "Converged" -> res[[2]],
+                 "Iterations" -> Length[res[[3]]], "History" -> res[[3]] |>
+           ]
+    ];
+
+TSILRescale[x_?NumericQ, y_?NumericQ, z_?NumericQ, u_?NumericQ, v_?NumericQ, s_?NumericQ, qq_?NumericQ,
+            res:{(_Symbol -> _?NumericQ)...}, qqNew_?NumericQ] :=
+    LL["TSILRescale"][N @ {x, y, z, u, v, Re[s], Im[s], qq}, SymbolName /@ res[[All, 1]],
+                      N @ Flatten[{Re[#], Im[#]}& /@ res[[All, 2]]], N[qqNew]];
+
+TSILRescale[x_?NumericQ, y_?NumericQ, z_?NumericQ, u_?NumericQ, v_?NumericQ, s_?NumericQ, qq_?NumericQ,
+            res_?(VectorQ[#, NumericQ]&), qqNew_?NumericQ] /; Length[res] === Length[TSILResultNames] :=
+    With[{rules = TSILRescale[x, y, z, u, v, s, qq, Thread[TSILResultNames -> res], qqNew]},
+         If[rules === $Failed, $Failed, Developer`ToPackedArray[rules[[All, 2]]]]
+    ];
+
+(* converts rows {x, y, z, u, v, s, qq} to {x, y, z, u, v, Re[s], Im[s], qq} *)
+ToBatchParameters[pars_] :=
+    With[{p = N[pars]},
+         Developer`ToPackedArray @ Transpose @
+            Join[Transpose[p[[All, 1;;5]]], {Re[p[[All, 6]]], Im[p[[All, 6]]], p[[All, 7]]}]
+    ];
+
+TSILEvaluateBatch[pars_?(MatrixQ[#, NumericQ]&)] /; Last[Dimensions[pars]] === 7 :=
+    Which[
+       $TSILServer =!= None,
+       EvaluateBatch["Default", "TSILRemoteEvaluateBatch", ToBatchParameters[pars]],
+       $TSILPrecision === "Adaptive",
+       EvaluateAdaptive[ToBatchParameters[pars]],
+       True,
+       EvaluateBatch[$TSILPrecision, "TSILEvaluateBatch", ToBatchParameters[pars]]
+    ];
+
+(* the result of an aborted library call is discarded by the kernel,
+   so the finished points are fetched separately *)
+EvaluateBatch[variant_, fun_String, pars_] :=
+    CheckAbort[
+        LL[variant, fun][pars],
+        With[{partial = LL[variant, "TSILTakePartialResults"][]},
+             Message[TSILEvaluateBatch::aborted, Length[partial], Length[pars]];
+             partial
+        ]
+    ];
+
+(* the connection is kept by the "Default" variant *)
+TSILConnect[] := TSILConnect[""];
+
+TSILConnect[socket_String] :=
+    With[{res = LL["Default", "TSILConnect"][{If[socket === "", "", ExpandFileName[socket]]}]},
+         If[StringQ[res], $TSILServer = res, $Failed]
+    ];
+
+TSILDisconnect[] := (LL["Default", "TSILDisconnect"][]; $TSILServer = None;);
+
+Options[TSILSubmit] = {"ChunkSize" -> Automatic, "ChunkFunction" -> None};
+
+(* the task runs in the library variant selected at submission *)
+TSILSubmit[pars_?(MatrixQ[#, NumericQ]&), OptionsPattern[]] /; Last[Dimensions[pars]] === 7 :=
+    Module[{chunk = OptionValue["ChunkSize"], f = OptionValue["ChunkFunction"], task},
+           task = Internal`CreateAsynchronousTask[
+               LL[$TSILPrecision, "TSILSubmit"],
+               {ToBatchParameters[pars], If[chunk === Automatic, 0, chunk]},
+               If[f === None, Null&, (f @@ #3)&]];
+           If[Head[task] === AsynchronousTaskObject, TSILTask[$TSILPrecision, task], $Failed]
+    ];
+
+TaskID[TSILTask[_, task_AsynchronousTaskObject]] := task[[2]];
+
+(* the status is taken before polling, so that all points are returned
+   once "Finished" is True *)
+TSILPoll[h:TSILTask[variant_, _]] :=
+    Module[{status = LL[variant, "TSILTaskStatus"][TaskID[h]], res},
+           res = LL[variant, "TSILPoll"][TaskID[h]];
+           If[MatchQ[res, _LibraryFunctionError] || MatchQ[status, _LibraryFunctionError],
+              $Failed,
+              <| "Results" -> res, "FirstIndex" -> status[[4]] + 1,
+                 "Completed" -> status[[4]] + Length[res], "Total" -> status[[2]],
+                 "Finished" -> status[[3]] === 1 |>
+           ]
+    ];
+
+(* the library releases the task when it fails or is aborted *)
+TSILCollect[h:TSILTask[variant_, task_]] :=
+    Module[{res = CheckAbort[LL[variant, "TSILCollect"][TaskID[h]],
+                             Quiet[RemoveAsynchronousTask[task]]; Abort[]]},
+           Quiet[RemoveAsynchronousTask[task]];
+           If[MatchQ[res, _LibraryFunctionError], $Failed, res]
+    ];
+
+TSILCancel[h:TSILTask[variant_, task_]] :=
+    (Quiet[RemoveAsynchronousTask[task]]; LL[variant, "TSILCancelTask"][TaskID[h]];);
+
+TSILEvaluateSweep[x_?NumericQ, y_?NumericQ, z_?NumericQ, u_?NumericQ, v_?NumericQ, s_?(VectorQ[#, NumericQ]&), qq_?NumericQ] :=
+    LL["TSILEvaluateSweep"][N @ {x, y, z, u, v, qq}, Developer`ToPackedArray[N[s] + 0. I]];
+
+(* each library variant manages its own sessions *)
+SessionManager["Default"] = "TSILSession";
+SessionManager["Double"]  = "TSILSessionDouble";
+
+SessionVariant[h_] := If[ManagedLibraryExpressionQ[h, SessionManager["Double"]], "Double", "Default"];
+
+SessionID[h_] := ManagedLibraryExpressionID[h, SessionManager[SessionVariant[h]]];
+
+TSILSessionCreate[x_?NumericQ, y_?NumericQ, z_?NumericQ, u_?NumericQ, v_?NumericQ, qq_?NumericQ] :=
+    Module[{h = CreateManagedLibraryExpression[SessionManager[$TSILPrecision], TSILSession]},
+           If[LL["TSILSessionInit"][SessionID[h], N @ {x, y, z, u, v, qq}] === $Failed, $Failed, h]
+    ];
+
+TSILSessionEvaluate[h_TSILSession?ManagedLibraryExpressionQ, s_?NumericQ] :=
+    LL[SessionVariant[h], "TSILSessionEvaluate"][SessionID[h], N @ {Re[s], Im[s]}];
+
+TSILSessionEvaluate[h_TSILSession?ManagedLibraryExpressionQ, s_?NumericQ, wanted:{___Symbol}] :=
+    LL[SessionVariant[h], "TSILSessionEvaluate"][SessionID[h], N @ {Re[s], Im[s]}, SymbolName /@ wanted];
+
+TSILSetNumberOfThreads[n_Integer?Positive] := LL["TSILSetNumberOfThreads"][n];
+
+TSILSetNumberOfThreads[Automatic] := LL["TSILSetNumberOfThreads"][0];
+
+TSILGetNumberOfThreads[] := LL["TSILGetNumberOfThreads"][];
+
+TSILCacheStatistics[] :=
+    AssociationThread[{"Hits", "Misses", "Entries", "Bytes", "MaxBytes", "RescaledHits"}, LL["TSILCacheStatistics"][]];
+
+(* rows of the statistics, ordered as the functions in the library *)
+StatisticsFunctions = {"Evaluate", "A", "Ap", "Aeps", "B", "Bp", "dBds", "Beps", "I", "Ip",
+                       "Ip2", "Ipp", "Ip3", "M", "S", "T", "Tbar", "U", "V"};
+
+ToStatistics[{calls_, hits_, analytic_, ode_, tAnalytic_, tODE_}] :=
+    <| "Calls" -> Round[calls], "CacheHits" -> Round[hits],
+       "Analytic" -> Round[analytic], "ODE" -> Round[ode],
+       "FallbackRate" -> If[analytic + ode > 0, ode/(analytic + ode), 0.],
+       "AnalyticSeconds" -> tAnalytic, "ODESeconds" -> tODE |>;
+
+TSILStatistics[] :=
+    With[{stats = LL["TSILFunctionStatistics"][]},
+         If[MatrixQ[stats, NumericQ],
+            Select[AssociationThread[StatisticsFunctions -> ToStatistics /@ stats], #["Calls"] > 0&],
+            $Failed]
+    ];
+
+TSILResetStatistics[] := LL["TSILResetStatistics"][];
+
+TSILTraceStatistics[] := ImportString[LL["TSILTracing"][], "RawJSON"];
+
+TSILTraceStatistics[file_String] := Export[file, LL["TSILTracing"][], "Text"];
+
+TSILResetTracing[] := LL["TSILResetTracing"][];
+
+TSILSetCacheNormalization[normalize:(True|False)] := LL["TSILSetCacheNormalization"][normalize];
+
+TSILSetCacheSize[bytes_Integer?NonNegative] := LL["TSILSetCacheSize"][bytes];
+
+TSILClearCache[] := LL["TSILClearCache"][];
+
+TSILSetResultStore[file_String, maxBytes_Integer?Positive:2^30] :=
+    LL["TSILSetResultStore"][{ExpandFileName[file]}, N[maxBytes]];
+
+TSILSetResultStore[None] := LL["TSILSetResultStore"][{""}, 0.];
+
+TSILResultStoreStatistics[] :=
+    AssociationThread[{"Hits", "Misses", "Rejected", "Entries", "Bytes", "MaxBytes"},
+                      LL["TSILResultStoreStatistics"][]];
+
+(* calls the native library function for machine numbers and the
+   LinkObject library function otherwise, where s at position k is
+   split into Re[s] and Im[s] *)
+CallTSIL[native_, link_, pars_List, k_:None] :=
+    If[VectorQ[pars, MachineNumberQ],
+       Replace[native @@ pars, _LibraryFunctionError -> $Failed],
+       link[If[k === None, pars,
+               Join[pars[[;; k - 1]], {Re[pars[[k]]], Im[pars[[k]]]}, pars[[k + 1 ;;]]]]]
+    ];
 
-TSILA[x_?NumericQ, qq_?NumericQ] := TSILALL[N @ {x, qq}];
+TSILA[x_?NumericQ, qq_?NumericQ] := CallTSIL[LL["TSILANative"], LL["TSILA"], N @ {x, qq}];
 
-TSILAp[x_?NumericQ, qq_?NumericQ] := TSILApLL[N @ {x, qq}];
+TSILAp[x_?NumericQ, qq_?NumericQ] := CallTSIL[LL["TSILApNative"], LL["TSILAp"], N @ {x, qq}];
 
-TSILAeps[x_?NumericQ, qq_?NumericQ] := TSILAepsLL[N @ {x, qq}];
+TSILAeps[x_?NumericQ, qq_?NumericQ] := CallTSIL[LL["TSILAepsNative"], LL["TSILAeps"], N @ {x, qq}];
 
-TSILB[x_?NumericQ, y_?NumericQ, s_?NumericQ, qq_?NumericQ] := TSILBLL[N @ {x, y, Re[s], Im[s], qq}];
+TSILB[x_?NumericQ, y_?NumericQ, s_?NumericQ, qq_?NumericQ] := CallTSIL[LL["TSILBNative"], LL["TSILB"], N @ {x, y, s, qq}, 3];
 
-TSILBp[x_?NumericQ, y_?NumericQ, s_?NumericQ, qq_?NumericQ] := TSILBpLL[N @ {x, y, Re[s], Im[s], qq}];
+TSILBp[x_?NumericQ, y_?NumericQ, s_?NumericQ, qq_?NumericQ] := CallTSIL[LL["TSILBpNative"], LL["TSILBp"], N @ {x, y, s, qq}, 3];
 
-TSILdBds[x_?NumericQ, y_?NumericQ, s_?NumericQ, qq_?NumericQ] := TSILdBdsLL[N @ {x, y, Re[s], Im[s], qq}];
+TSILdBds[x_?NumericQ, y_?NumericQ, s_?NumericQ, qq_?NumericQ] := CallTSIL[LL["TSILdBdsNative"], LL["TSILdBds"], N @ {x, y, s, qq}, 3];
 
-TSILBeps[x_?NumericQ, y_?NumericQ, s_?NumericQ, qq_?NumericQ] := TSILBepsLL[N @ {x, y, Re[s], Im[s], qq}];
+TSILBeps[x_?NumericQ, y_?NumericQ, s_?NumericQ, qq_?NumericQ] := CallTSIL[LL["TSILBepsNative"], LL["TSILBeps"], N @ {x, y, s, qq}, 3];
 
-TSILI[x_?NumericQ, y_?NumericQ, z_?NumericQ, qq_?NumericQ] := TSILILL[N @ {x, y, z, qq}];
+TSILI[x_?NumericQ, y_?NumericQ, z_?NumericQ, qq_?NumericQ] := CallTSIL[LL["TSILINative"], LL["TSILI"], N @ {x, y, z, qq}];
 
-TSILIp[x_?NumericQ, y_?NumericQ, z_?NumericQ, qq_?NumericQ] := TSILIpLL[N @ {x, y, z, qq}];
+TSILIp[x_?NumericQ, y_?NumericQ, z_?NumericQ, qq_?NumericQ] := CallTSIL[LL["TSILIpNative"], LL["TSILIp"], N @ {x, y, z, qq}];
 
-TSILIp2[x_?NumericQ, y_?NumericQ, z_?NumericQ, qq_?NumericQ] := TSILIp2LL[N @ {x, y, z, qq}];
+TSILIp2[x_?NumericQ, y_?NumericQ, z_?NumericQ, qq_?NumericQ] := CallTSIL[LL["TSILIp2Native"], LL["TSILIp2"], N @ {x, y, z, qq}];
 
-TSILIpp[x_?NumericQ, y_?NumericQ, z_?NumericQ, qq_?NumericQ] := TSILIppLL[N @ {x, y, z, qq}];
+TSILIpp[x_?NumericQ, y_?NumericQ, z_?NumericQ, qq_?NumericQ] := CallTSIL[LL["TSILIppNative"], LL["TSILIpp"], N @ {x, y, z, qq}];
 
-TSILIp3[x_?NumericQ, y_?NumericQ, z_?NumericQ, qq_?NumericQ] := TSILIp3LL[N @ {x, y, z, qq}];
+TSILIp3[x_?NumericQ, y_?NumericQ, z_?NumericQ, qq_?NumericQ] := CallTSIL[LL["TSILIp3Native"], LL["TSILIp3"], N @ {x, y, z, qq}];
 
-TSILM[x_?NumericQ, y_?NumericQ, z_?NumericQ, u_?NumericQ, v_?NumericQ, s_?NumericQ] := TSILMLL[N @ {x, y, z, u, v, Re[s], Im[s]}];
+TSILM[x_?NumericQ, y_?NumericQ, z_?NumericQ, u_?NumericQ, v_?NumericQ, s_?NumericQ] := CallTSIL[LL["TSILMNative"], LL["TSILM"], N @ {x, y, z, u, v, s}, 6];
 
-TSILS[x_?NumericQ, y_?NumericQ, z_?NumericQ, s_?NumericQ, qq_?NumericQ] := TSILSLL[N @ {x, y, z, Re[s], Im[s], qq}];
+TSILS[x_?NumericQ, y_?NumericQ, z_?NumericQ, s_?NumericQ, qq_?NumericQ] := CallTSIL[LL["TSILSNative"], LL["TSILS"], N @ {x, y, z, s, qq}, 4];
 
-TSILT[x_?NumericQ, y_?NumericQ, z_?NumericQ, s_?NumericQ, qq_?NumericQ] := TSILTLL[N @ {x, y, z, Re[s], Im[s], qq}];
+TSILT[x_?NumericQ, y_?NumericQ, z_?NumericQ, s_?NumericQ, qq_?NumericQ] := CallTSIL[LL["TSILTNative"], LL["TSILT"], N @ {x, y, z, s, qq}, 4];
 
-TSILTbar[x_?NumericQ, y_?NumericQ, z_?NumericQ, s_?NumericQ, qq_?NumericQ] := TSILTbarLL[N @ {x, y, z, Re[s], Im[s], qq}];
+TSILTbar[x_?NumericQ, y_?NumericQ, z_?NumericQ, s_?NumericQ, qq_?NumericQ] := CallTSIL[LL["TSILTbarNative"], LL["TSILTbar"], N @ {x, y, z, s, qq}, 4];
 
-TSILU[x_?NumericQ, y_?NumericQ, z_?NumericQ, u_?NumericQ, s_?NumericQ, qq_?NumericQ] := TSILULL[N @ {x, y, z, u, Re[s], Im[s], qq}];
+TSILU[x_?NumericQ, y_?NumericQ, z_?NumericQ, u_?NumericQ, s_?NumericQ, qq_?NumericQ] := CallTSIL[LL["TSILUNative"], LL["TSILU"], N @ {x, y, z, u, s, qq}, 5];
 
-TSILV[x_?NumericQ, y_?NumericQ, z_?NumericQ, u_?NumericQ, s_?NumericQ, qq_?NumericQ] := TSILVLL[N @ {x, y, z, u, Re[s], Im[s], qq}];
+TSILV[x_?NumericQ, y_?NumericQ, z_?NumericQ, u_?NumericQ, s_?NumericQ, qq_?NumericQ] := CallTSIL[LL["TSILVNative"], LL["TSILV"], N @ {x, y, z, u, s, qq}, 5];
 
 End[];
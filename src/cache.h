@@ -0,0 +1,161 @@
+// ====================================================================
+// This file is part of tsil-mma.
+//
+// tsil-mma is licenced under the GNU General Public License (GNU GPL)
+// version 3.
+// ====================================================================
+
+#ifndef TSIL_MMA_CACHE_H
+#define TSIL_MMA_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * Thread-safe key-value cache with a memory limit.  When the limit is
+ * exceeded, the least recently used entries are evicted.
+ *
+ * The memory of an entry is estimated from the sizes of the key, the
+ * value and the bookkeeping nodes, plus the heap memory of the value
+ * if it is a std::vector (or a std::pair containing one).
+ *
+ * Every key must compare equal to itself, so keys containing NaN must
+ * be rejected by the caller.
+ */
+template <class Key, class Value, class Hash = std::hash<Key>>
+class LRU_cache {
+public:
+   struct Statistics {
+      std::uint64_t hits{0};
+      std::uint64_t misses{0};
+      std::size_t entries{0};
+      std::size_t bytes{0};
+      std::size_t max_bytes{0};
+   };
+
+   explicit LRU_cache(std::size_t max_bytes_) : max_bytes(max_bytes_) {}
+
+   /**
+    * Looks up the key.  On a hit, consume(value) is called while the
+    * cache is locked and true is returned.
+    */
+   template <class F>
+   bool get(const Key& key, F&& consume)
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+
+      if (max_bytes == 0) {
+         return false;
+      }
+
+      const auto it = map.find(key);
+
+      if (it == map.end()) {
+         misses++;
+         return false;
+      }
+
+      hits++;
+      entries.splice(entries.begin(), entries, it->second);
+      consume(static_cast<const Value&>(it->second->second));
+
+      return true;
+   }
+
+   /// inserts or replaces an entry and evicts old entries if needed
+   void put(const Key& key, Value value)
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+
+      const std::size_t size = entry_size(value);
+
+      if (size > max_bytes) {
+         return;
+      }
+
+      const auto it = map.find(key);
+
+      if (it != map.end()) {
+         bytes -= entry_size(it->second->second);
+         entries.erase(it->second);
+         map.erase(it);
+      }
+
+      entries.emplace_front(key, std::move(value));
+      map.emplace(key, entries.begin());
+      bytes += size;
+
+      evict();
+   }
+
+   /// removes all entries and resets the counters
+   void clear()
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      entries.clear();
+      map.clear();
+      bytes = 0;
+      hits = 0;
+      misses = 0;
+   }
+
+   /// sets the memory limit (0 disables the cache)
+   void set_max_bytes(std::size_t max_bytes_)
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      max_bytes = max_bytes_;
+      evict();
+   }
+
+   Statistics statistics() const
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      return Statistics{hits, misses, map.size(), bytes, max_bytes};
+   }
+
+private:
+   using Entry = std::pair<Key, Value>;
+   using Entry_list = std::list<Entry>;
+
+   mutable std::mutex mutex;
+   Entry_list entries; ///< most recently used first
+   std::unordered_map<Key, typename Entry_list::iterator, Hash> map;
+   std::size_t max_bytes{0};
+   std::size_t bytes{0};
+   std::uint64_t hits{0};
+   std::uint64_t misses{0};
+
+   /// estimated memory of an entry, including list and map nodes
+   static std::size_t entry_size(const Value& value)
+   {
+      return sizeof(Entry) + sizeof(Key) + sizeof(typename Entry_list::iterator)
+         + 4*sizeof(void*) + heap_size(value);
+   }
+
+   template <class T>
+   static std::size_t heap_size(const T&) { return 0; }
+
+   template <class T>
+   static std::size_t heap_size(const std::vector<T>& v) { return v.capacity()*sizeof(T); }
+
+   template <class T, class U>
+   static std::size_t heap_size(const std::pair<T, U>& p) { return heap_size(p.first) + heap_size(p.second); }
+
+   void evict()
+   {
+      while (bytes > max_bytes && !entries.empty()) {
+         const auto& last = entries.back();
+         bytes -= entry_size(last.second);
+         map.erase(last.first);
+         entries.pop_back();
+      }
+   }
+};
+
+#endif
@@ -5,16 +5,30 @@
 // version 3.
 // ====================================================================
 
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <complex>
-#include <iostream>
-#include <sstream>
+#include <condition_variable>
+#include <ostream>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <mathlink.h>
 #include <WolframLibrary.h>
+#include <WolframIOLibraryFunctions.h>
 
-#include "tsil_cpp.h"
+#include <unistd.h>
+
+#include "protocol.h"
+#include "tsil_mma.h"
+#include "tracing.h"
+
+using namespace tsil_mma;
 
 namespace {
 
@@ -71,6 +85,30 @@ void MLPutRuleTo(MLINK link, T1 t, const T2& name)
 
 template<class T> T MLRead(MLINK link);
 
+template<>
+[[maybe_unused]] int MLRead(MLINK link)
+{
+   int val = 0;
+
+   if (MLGetInteger(link, &val) == 0) {
+      throw std::runtime_error("Cannot read integer from parameter list!");
+   }
+
+   return val;
+}
+
+template<>
+[[maybe_unused]] mlint64 MLRead(MLINK link)
+{
+   mlint64 val = 0;
+
+   if (MLGetInteger64(link, &val) == 0) {
+      throw std::runtime_error("Cannot read integer from parameter list!");
+   }
+
+   return val;
+}
+
 template<>
 [[maybe_unused]] double MLRead(MLINK link)
 {
@@ -106,49 +144,88 @@ void put_message(MLINK link,
    MLPutUTF8String(link, reinterpret_cast<const unsigned char*>(message_str.c_str()), message_str.size());
 }
 
+/// puts a message from a library function without a LinkObject
+/// argument, by evaluating it in the kernel
+void put_message(WolframLibraryData libData,
+                 const std::string& message_function,
+                 const std::string& message_str)
+{
+   MLINK link = libData->getMathLink(libData);
+
+   MLPutFunction(link, "EvaluatePacket", 1);
+   MLPutFunction(link, message_function.c_str(), 1);
+   MLPutUTF8String(link, reinterpret_cast<const unsigned char*>(message_str.c_str()), message_str.size());
+   libData->processMathLink(link);
+
+   if (MLNextPacket(link) == RETURNPKT) {
+      MLNewPacket(link);
+   }
+}
+
 /******************************************************************/
 
-class Redirect_output {
+/// calls f(line) for each line of the string
+template <class F>
+void for_each_line(const std::string& str, F&& f)
+{
+   std::string::size_type begin = 0;
+
+   while (begin < str.size()) {
+      auto end = str.find('\n', begin);
+      if (end == std::string::npos) {
+         end = str.size();
+      }
+      f(str.substr(begin, end - begin));
+      begin = end + 1;
+   }
+}
+
+/**
+ * Puts the diagnostic output, which has been written by the calling
+ * thread during the lifetime of this object, as TSILInfoMessage.
+ */
+class Capture_diagnostics {
 public:
-   explicit Redirect_output(MLINK link_)
+   explicit Capture_diagnostics(MLINK link_)
       : link(link_)
-      , old_cout(std::cout.rdbuf(buffer.rdbuf()))
-      , old_cerr(std::cerr.rdbuf(buffer.rdbuf()))
       {}
 
-   Redirect_output(const Redirect_output&) = delete;
-   Redirect_output(Redirect_output&&) = delete;
-   Redirect_output& operator=(const Redirect_output&) = delete;
-   Redirect_output& operator=(Redirect_output&&) = delete;
+   explicit Capture_diagnostics(WolframLibraryData libData_)
+      : libData(libData_)
+      {}
+
+   Capture_diagnostics(const Capture_diagnostics&) = delete;
+   Capture_diagnostics(Capture_diagnostics&&) = delete;
+   Capture_diagnostics& operator=(const Capture_diagnostics&) = delete;
+   Capture_diagnostics& operator=(Capture_diagnostics&&) = delete;
 
-   ~Redirect_output() {
-      std::cout.rdbuf(old_cout);
-      std::cerr.rdbuf(old_cerr);
+   ~Capture_diagnostics() {
       flush();
    }
 
    void flush() {
-      std::string line;
-      while (std::getline(buffer, line)) {
-         put_message(link, "TSILInfoMessage", line);
-      }
+      for_each_line(take_diagnostics(), [this] (const std::string& line) {
+         if (link) {
+            put_message(link, "TSILInfoMessage", line);
+         } else {
+            put_message(libData, "TSILInfoMessage", line);
+         }
+      });
    }
 
 private:
-   MLINK link;               ///< redirect to this link
-   std::stringstream buffer; ///< buffer caching stdout
-   std::streambuf* old_cout; ///< original stdout buffer
-   std::streambuf* old_cerr; ///< original stderr buffer
+   MLINK link{nullptr};                 ///< put messages to this link
+   WolframLibraryData libData{nullptr}; ///< or to the kernel of this library
 };
 
 /******************************************************************/
 
 long number_of_args(MLINK link, const std::string& head)
 {
-   long argc;
+   long argc = 0;
 
    if (MLCheckFunction(link, head.c_str(), &argc) == 0) {
-      std::cerr << "Error: argument is not a " << head << std::endl;
+      diagnostics() << "Error: argument is not a " << head << '\n';
    }
 
    return argc;
@@ -163,9 +240,9 @@ bool check_number_of_args(MLINK link, long number_of_arguments,
    const bool ok = n_given == number_of_arguments;
 
    if (!ok) {
-      std::cerr << "Error: " << function_name << " expects "
-                << number_of_arguments << " argument ("
-                << n_given << " given)." << std::endl;
+      diagnostics() << "Error: " << function_name << " expects "
+                    << number_of_arguments << " argument ("
+                    << n_given << " given).\n";
    }
 
    return ok;
@@ -173,7 +250,26 @@ bool check_number_of_args(MLINK link, long number_of_arguments,
 
 /******************************************************************/
 
-std::vector<TSIL_REAL> read_list(MLINK link)
+/**
+ * Discards the arguments of a LinkObject function that has been
+ * called with wrong arguments and puts the diagnostic output as
+ * TSILErrorMessage.
+ */
+int argument_error(MLINK link)
+{
+   MLNewPacket(link);
+
+   for_each_line(take_diagnostics(), [link] (const std::string& line) {
+      put_message(link, "TSILErrorMessage", line);
+   });
+
+   return LIBRARY_TYPE_ERROR;
+}
+
+/******************************************************************/
+
+/// reads a list of real numbers
+std::vector<TSIL_REAL> read_reals(MLINK link)
 {
    int N = 0;
 
@@ -188,6 +284,36 @@ std::vector<TSIL_REAL> read_list(MLINK link)
       v = MLRead<TSIL_REAL>(link);
    }
 
+   return vec;
+}
+
+/// reads a list of strings
+std::vector<std::string> read_strings(MLINK link)
+{
+   int N = 0;
+
+   if (MLTestHead(link, "List", &N) == 0) {
+      throw std::runtime_error("Expecting a list of strings!");
+   }
+
+   std::vector<std::string> vec(N);
+
+   for (auto& v: vec) {
+      const char* str = nullptr;
+      if (MLGetString(link, &str) == 0) {
+         throw std::runtime_error("Cannot read string from list!");
+      }
+      v = str;
+      MLReleaseString(link, str);
+   }
+
+   return vec;
+}
+
+std::vector<TSIL_REAL> read_list(MLINK link)
+{
+   auto vec = read_reals(link);
+
    if (MLNewPacket(link) == 0) {
       throw std::runtime_error("Cannot create new packet!");
    }
@@ -197,238 +323,531 @@ std::vector<TSIL_REAL> read_list(MLINK link)
 
 /******************************************************************/
 
-struct TSIL_Mma_results {
-   TSIL_DATA data{};
-   TSIL_COMPLEXCPP Ax{}, Ay{}, Az{}, Au{}, Av{};
-   TSIL_COMPLEXCPP Ixyv{}, Izuv{};
-};
+void put_results(const Results& results, MLINK link)
+{
+   const auto& names = result_names();
 
-/******************************************************************/
+   MLPutFunction(link, "List", NUMBER_OF_RESULTS);
+
+   for (int k = 0; k < NUMBER_OF_RESULTS; k++) {
+      MLPutRuleTo(link, results[k], names[k]);
+   }
+}
 
-TSIL_Mma_results calculate_results(const std::vector<TSIL_REAL>& parsvec)
+/// writes the results into a row of a complex MTensor
+void put_results(const Results& results, mcomplex* row)
 {
-   int c = 0; // counter
+   for (const auto& value: results) {
+      mcreal(*row) = static_cast<mreal>(std::real(value));
+      mcimag(*row) = static_cast<mreal>(std::imag(value));
+      row++;
+   }
+}
+
+/******************************************************************/
 
-   const TSIL_REAL x  = parsvec.at(c++);
-   const TSIL_REAL y  = parsvec.at(c++);
-   const TSIL_REAL z  = parsvec.at(c++);
-   const TSIL_REAL u  = parsvec.at(c++);
-   const TSIL_REAL v  = parsvec.at(c++);
-   const TSIL_REAL rs = parsvec.at(c++); // Re(s)
-   [[maybe_unused]] const TSIL_REAL is = parsvec.at(c++); // Im(s) is unused
-   const TSIL_REAL qq = parsvec.at(c++);
+/**
+ * Calculates an integral function called with a LinkObject: the
+ * arguments are read as list, where s is passed as Re(s) and Im(s).
+ */
+int calculate_linkobject(Function function, const std::string& function_name, MLINK link)
+{
+   Trace_scope trace(function_name.c_str());
 
-   if (static_cast<std::size_t>(c) != parsvec.size()) {
-      throw std::runtime_error(
-         "Bug: Expecting to read " + std::to_string(parsvec.size()) +
-         " input parameters from input vector, but only " + std::to_string(c) +
-         " parameters have been read.");
+   if (!check_number_of_args(link, 1, function_name)) {
+      return argument_error(link);
    }
 
-   TSIL_Mma_results results;
+   try {
+      const auto parsvec = read_list(link);
+
+      if (parsvec.size() != number_of_arguments(function)) {
+         throw std::runtime_error(
+            function_name + " expects " + std::to_string(number_of_arguments(function)) +
+            " parameters, but " + std::to_string(parsvec.size()) + " are given.");
+      }
 
-   TSIL_SetParameters_(&results.data, x, y, z, u, v, qq);
-   TSIL_Evaluate_(&results.data, rs);
+      TSIL_COMPLEXCPP value;
 
-   results.Ax = TSIL_A_(x, qq);
-   results.Ay = TSIL_A_(y, qq);
-   results.Az = TSIL_A_(z, qq);
-   results.Au = TSIL_A_(u, qq);
-   results.Av = TSIL_A_(v, qq);
+      {
+         trace.phase(Phase::Compute);
+         Capture_diagnostics cd(link);
+         value = calculate_integral({function, parsvec});
+      }
 
-   results.Ixyv = TSIL_I2_(x, y, v, qq);
-   results.Izuv = TSIL_I2_(z, u, v, qq);
+      trace.phase(Phase::Marshal);
+      MLPut(link, value);
+   } catch (const std::exception& e) {
+      put_message(link, "TSILErrorMessage", e.what());
+      MLPutSymbol(link, "$Failed");
+   } catch (...) {
+      put_message(link, "TSILErrorMessage", "An unknown exception has been thrown.");
+      MLPutSymbol(link, "$Failed");
+   }
 
-   return results;
+   return LIBRARY_NO_ERROR;
 }
 
-void put_results(TSIL_Mma_results& results, MLINK link)
+/**
+ * Calculates an integral function called with native LibraryLink
+ * arguments: s is passed as Complex, all other arguments as Real.
+ * The result is returned as Complex.
+ */
+int calculate_native(Function function, WolframLibraryData libData,
+                     mint Argc, MArgument* Args, MArgument Res)
 {
-#include "tsil_global.h"
-#include "tsil_names.h"
+   // names of the native entry points, e.g. "TSILBNative"
+   static const auto trace_names = [] {
+      std::array<std::string, NUMBER_OF_FUNCTIONS> names;
+      for (int f = 0; f < NUMBER_OF_FUNCTIONS; f++) {
+         names[f] = "TSIL" + function_name(static_cast<Function>(f)) + "Native";
+      }
+      return names;
+   }();
 
-   const int len = 1 // M
-      + NUM_U_FUNCS * NUM_U_PERMS // U
-      + 2 * NUM_T_FUNCS * NUM_T_PERMS // T and Tbar
-      + NUM_S_FUNCS * NUM_S_PERMS // S
-      + NUM_B_FUNCS * NUM_B_PERMS // B
-      + NUM_V_FUNCS * NUM_V_PERMS // V
-      + 5 // A
-      + 2 // I
-      ;
+   Trace_scope trace(trace_names[static_cast<int>(function)].c_str());
 
-   MLPutFunction(link, "List", len);
-   MLPutRuleTo(link, TSIL_GetFunction_(&results.data, "M"), "Mxyzuv");
+   const int s_pos = s_position(function);
+   const auto n_args = number_of_arguments(function) - (s_pos >= 0 ? 1 : 0);
 
-   for (const auto& func : uname) {
-      for (const auto& p : func) {
-         MLPutRuleTo(link, TSIL_GetFunction_(&results.data, p), p);
-      }
+   if (static_cast<std::size_t>(Argc) != n_args) {
+      return LIBRARY_FUNCTION_ERROR;
    }
 
-   for (const auto& func : tname) {
-      for (const auto& p : func) {
-         MLPutRuleTo(link, TSIL_GetFunction_(&results.data, p), p);
+   Integral in;
+   in.function = function;
+   in.args.reserve(number_of_arguments(function));
+
+   for (mint i = 0; i < Argc; i++) {
+      if (i == s_pos) {
+         const mcomplex s = MArgument_getComplex(Args[i]);
+         in.args.push_back(mcreal(s));
+         in.args.push_back(mcimag(s));
+      } else {
+         in.args.push_back(MArgument_getReal(Args[i]));
       }
    }
 
-   for (const auto& func : tbarname) {
-      for (const auto& p : func) {
-         MLPutRuleTo(link, TSIL_GetFunction_(&results.data, p), p);
+   try {
+      TSIL_COMPLEXCPP value;
+
+      {
+         trace.phase(Phase::Compute);
+         Capture_diagnostics cd(libData);
+         value = calculate_integral(in);
       }
+
+      trace.phase(Phase::Marshal);
+      mcomplex res;
+      mcreal(res) = static_cast<mreal>(std::real(value));
+      mcimag(res) = static_cast<mreal>(std::imag(value));
+      MArgument_setComplex(Res, res);
+   } catch (const std::exception& e) {
+      put_message(libData, "TSILErrorMessage", e.what());
+      return LIBRARY_FUNCTION_ERROR;
+   } catch (...) {
+      put_message(libData, "TSILErrorMessage", "An unknown exception has been thrown.");
+      return LIBRARY_FUNCTION_ERROR;
    }
 
-   for (const auto& func : sname) {
-      for (const auto& p : func) {
-         MLPutRuleTo(link, TSIL_GetFunction_(&results.data, p), p);
-      }
+   return LIBRARY_NO_ERROR;
+}
+
+/// reads a list of integrals {{"name", {args...}}, ...}
+std::vector<Integral> read_integrals(MLINK link)
+{
+   int n_integrals = 0;
+
+   if (MLTestHead(link, "List", &n_integrals) == 0) {
+      throw std::runtime_error("Expecting a list of integrals!");
    }
 
-   for (const auto& func : bname) {
-      for (const auto& p : func) {
-         MLPutRuleTo(link, TSIL_GetFunction_(&results.data, p), p);
+   std::vector<Integral> integrals(n_integrals);
+
+   for (auto& in: integrals) {
+      int n = 0;
+
+      if (MLTestHead(link, "List", &n) == 0 || n != 2) {
+         throw std::runtime_error("Expecting integrals of the form"
+                                  " {name, {arguments}}!");
       }
-   }
 
-   for (const auto& func : vname) {
-      for (const auto& p : func) {
-         MLPutRuleTo(link, TSIL_GetFunction_(&results.data, p), p);
+      const char* name = nullptr;
+
+      if (MLGetString(link, &name) == 0) {
+         throw std::runtime_error("Cannot read integral name!");
+      }
+
+      const std::string function_name(name);
+      MLReleaseString(link, name);
+
+      in.function = function_from_name(function_name);
+
+      if (MLTestHead(link, "List", &n) == 0 ||
+          static_cast<std::size_t>(n) != number_of_arguments(in.function)) {
+         throw std::runtime_error("Wrong number of arguments of " + function_name + ".");
+      }
+
+      in.args.resize(n);
+
+      for (auto& a: in.args) {
+         a = MLRead<TSIL_REAL>(link);
       }
    }
 
-#define MLPutRuleToTSILFunction(name) \
-   MLPutRuleTo(link, results.name, #name)
+   return integrals;
+}
 
-   MLPutRuleToTSILFunction(Ax);
-   MLPutRuleToTSILFunction(Ay);
-   MLPutRuleToTSILFunction(Az);
-   MLPutRuleToTSILFunction(Au);
-   MLPutRuleToTSILFunction(Av);
+void put_values(const std::vector<TSIL_COMPLEXCPP>& values, MLINK link)
+{
+   MLPutFunction(link, "List", values.size());
 
-   MLPutRuleToTSILFunction(Ixyv);
-   MLPutRuleToTSILFunction(Izuv);
+   for (const auto& v: values) {
+      MLPut(link, v);
+   }
+}
 
-#undef MLPutRuleToTSILFunction
+/**
+ * Puts the values as n x 2 array {{Re, Im}, ...} of Real64 (bits =
+ * 64) or Real128 (bits = 128) numbers.
+ */
+void put_values_array(const std::vector<TSIL_COMPLEXCPP>& values, int bits, MLINK link)
+{
+   int dims[2] = { static_cast<int>(values.size()), 2 };
+
+   if (bits == 128) {
+      std::vector<long double> a;
+      a.reserve(2*values.size());
+      for (const auto& v: values) {
+         a.push_back(std::real(v));
+         a.push_back(std::imag(v));
+      }
+      MLPutReal128Array(link, a.data(), dims, nullptr, 2);
+   } else {
+      std::vector<double> a;
+      a.reserve(2*values.size());
+      for (const auto& v: values) {
+         a.push_back(static_cast<double>(std::real(v)));
+         a.push_back(static_cast<double>(std::imag(v)));
+      }
+      MLPutReal64Array(link, a.data(), dims, nullptr, 2);
+   }
 }
 
-} // anonymous namespace
+/// puts the values as list of rules name -> value
+void put_values(const std::vector<TSIL_COMPLEXCPP>& values,
+                const std::vector<std::string>& names, MLINK link)
+{
+   MLPutFunction(link, "List", values.size());
 
-extern "C" {
+   for (std::size_t k = 0; k < values.size(); k++) {
+      MLPutRuleTo(link, values[k], names[k]);
+   }
+}
 
 /******************************************************************/
 
-DLLEXPORT int TSILEvaluate(
-   WolframLibraryData /* libData */, MLINK link)
+/// name of the managed library expressions of sessions
+#ifdef TSIL_MMA_VARIANT_DOUBLE
+const char SESSION_MANAGER[] = "TSILSessionDouble";
+#else
+const char SESSION_MANAGER[] = "TSILSession";
+#endif
+
+std::mutex sessions_mutex;
+
+/// sessions by the ID of their TSILSession expression
+std::unordered_map<mint, std::shared_ptr<Session>> sessions;
+
+/// called by the kernel when a TSILSession expression is released
+void manage_session(WolframLibraryData /* libData */, mbool mode, mint id)
 {
-   if (!check_number_of_args(link, 1, "TSILEvaluate")) {
-      return LIBRARY_TYPE_ERROR;
+   if (mode != 0) {
+      std::lock_guard<std::mutex> lock(sessions_mutex);
+      sessions.erase(id);
    }
+}
 
-   try {
-      TSIL_Mma_results results;
+std::shared_ptr<Session> find_session(mint id)
+{
+   std::lock_guard<std::mutex> lock(sessions_mutex);
 
-      {
-         Redirect_output rd(link);
-         results = calculate_results(read_list(link));
-      }
+   const auto it = sessions.find(id);
 
-      put_results(results, link);
-   } catch (const std::exception& e) {
-      put_message(link, "TSILErrorMessage", e.what());
-      MLPutSymbol(link, "$Failed");
-   } catch (...) {
-      put_message(link, "TSILErrorMessage", "An unknown exception has been thrown.");
-      MLPutSymbol(link, "$Failed");
+   if (it == sessions.end()) {
+      throw std::runtime_error("Invalid TSILSession " + std::to_string(id) + ".");
    }
 
-   return LIBRARY_NO_ERROR;
+   return it->second;
 }
 
 /******************************************************************/
 
-DLLEXPORT int TSILA(WolframLibraryData /* libData */, MLINK link)
+std::mutex partial_results_mutex;
+
+/// finished points of the last aborted TSILEvaluateBatch
+std::vector<Results> partial_results;
+
+/******************************************************************/
+
+/// number of points sent to tsil-mma-server at once
+constexpr std::size_t REMOTE_CHUNK_SIZE = 4096;
+
+static_assert(REMOTE_CHUNK_SIZE <= MAX_POINTS_PER_MESSAGE,
+              "REMOTE_CHUNK_SIZE exceeds the size of a request");
+
+/// connection to tsil-mma-server, closed when the last user releases it
+struct Server_connection {
+   explicit Server_connection(int fd_) : fd(fd_) {}
+   ~Server_connection() { close(fd); }
+
+   Server_connection(const Server_connection&) = delete;
+   Server_connection& operator=(const Server_connection&) = delete;
+
+   const int fd;
+   std::mutex mutex; ///< serializes the requests
+};
+
+std::mutex server_mutex;
+
+/// current connection to tsil-mma-server (null = not connected)
+std::shared_ptr<Server_connection> server;
+
+std::shared_ptr<Server_connection> get_server()
 {
-   if (!check_number_of_args(link, 1, "TSILA")) {
-      return LIBRARY_TYPE_ERROR;
+   std::lock_guard<std::mutex> lock(server_mutex);
+   return server;
+}
+
+/// closes the connection once it is not in use anymore
+void disconnect_from_server()
+{
+   std::lock_guard<std::mutex> lock(server_mutex);
+   server.reset();
+}
+
+/******************************************************************/
+
+/**
+ * Batch of parameter points evaluated by an asynchronous task, see
+ * TSILSubmit.  The chunks are evaluated in order, so the finished
+ * points are always [0, done).
+ */
+struct Job {
+   WolframIOLibrary_Functions io{nullptr};
+   std::vector<Parameters> points;
+   std::size_t chunk_size{1};
+
+   std::mutex mutex;                    ///< protects the fields below
+   std::condition_variable progress;    ///< notified after each chunk
+   std::vector<Results> results;
+   std::vector<std::string> messages;   ///< diagnostic output not yet put
+   std::size_t done{0};                 ///< number of finished points
+   std::size_t fetched{0};              ///< number of points returned
+   bool finished{false};
+   bool cancelled{false};
+   std::string error;
+
+   bool removed{false};                 ///< task removed, protected by jobs_mutex
+};
+
+std::mutex jobs_mutex;
+
+/// jobs by the ID of their asynchronous task
+std::unordered_map<mint, std::shared_ptr<Job>> jobs;
+
+std::shared_ptr<Job> find_job(mint id)
+{
+   std::lock_guard<std::mutex> lock(jobs_mutex);
+
+   const auto it = jobs.find(id);
+
+   if (it == jobs.end()) {
+      throw std::runtime_error("Invalid TSILTask " + std::to_string(id) + ".");
+   }
+
+   return it->second;
+}
+
+/// releases the job of a task, which cannot be collected anymore
+void release_job(mint id, Job& job)
+{
+   {
+      std::lock_guard<std::mutex> lock(job.mutex);
+      job.cancelled = true;
    }
 
+   std::lock_guard<std::mutex> lock(jobs_mutex);
+   job.removed = true;
+   jobs.erase(id);
+}
+
+/// body of the asynchronous task, which owns a std::shared_ptr<Job>
+void run_job(mint task_id, void* init_data)
+{
+   const std::unique_ptr<std::shared_ptr<Job>> owner(static_cast<std::shared_ptr<Job>*>(init_data));
+   Job& job = **owner;
+
    try {
-      const auto parsvec = read_list(link);
-      const TSIL_REAL x  = parsvec.at(0);
-      const TSIL_REAL qq = parsvec.at(1);
+      for (std::size_t first = 0; first < job.points.size(); first += job.chunk_size) {
+         {
+            std::lock_guard<std::mutex> lock(job.mutex);
+            if (job.cancelled) {
+               break;
+            }
+         }
 
-      TSIL_COMPLEXCPP A;
+         // the task has been removed without TSILCancel
+         if (!job.io->asynchronousTaskAliveQ(task_id)) {
+            release_job(task_id, job);
+            break;
+         }
 
-      {
-         Redirect_output rd(link);
-         A = TSIL_A_(x, qq);
-      }
+         const std::size_t last = std::min(first + job.chunk_size, job.points.size());
+         const std::vector<Parameters> chunk(job.points.begin() + first, job.points.begin() + last);
+         std::vector<std::string> messages;
+
+         auto results = calculate_results(chunk, &messages);
+
+         {
+            std::lock_guard<std::mutex> lock(job.mutex);
+            std::move(results.begin(), results.end(), job.results.begin() + first);
+            for (std::size_t i = 0; i < messages.size(); i++) {
+               for_each_line(messages[i], [&job, i, first] (const std::string& line) {
+                  job.messages.push_back("Point " + std::to_string(first + i + 1) + ": " + line);
+               });
+            }
+            job.done = last;
+         }
+         job.progress.notify_all();
 
-      MLPut(link, A);
+         // event data: index of the first point of the chunk and number of points
+         DataStore data = job.io->createDataStore();
+         job.io->DataStore_addInteger(data, static_cast<mint>(first + 1));
+         job.io->DataStore_addInteger(data, static_cast<mint>(last - first));
+         job.io->raiseAsyncEvent(task_id, const_cast<char*>("ChunkFinished"), data);
+      }
    } catch (const std::exception& e) {
-      put_message(link, "TSILErrorMessage", e.what());
-      MLPutSymbol(link, "$Failed");
+      std::lock_guard<std::mutex> lock(job.mutex);
+      job.error = e.what();
    } catch (...) {
-      put_message(link, "TSILErrorMessage", "An unknown exception has been thrown.");
-      MLPutSymbol(link, "$Failed");
+      std::lock_guard<std::mutex> lock(job.mutex);
+      job.error = "An unknown exception has been thrown.";
    }
 
-   return LIBRARY_NO_ERROR;
+   {
+      std::lock_guard<std::mutex> lock(job.mutex);
+      job.finished = true;
+   }
+   job.progress.notify_all();
 }
 
-/******************************************************************/
-
-DLLEXPORT int TSILAp(WolframLibraryData /* libData */, MLINK link)
+/**
+ * Returns the points of the job which are finished but have not been
+ * returned yet as an N x 32 tensor.  The diagnostic output and errors
+ * of the job are put as messages.
+ */
+int fetch_job_results(WolframLibraryData libData, Job& job, MArgument Res)
 {
-   if (!check_number_of_args(link, 1, "TSILAp")) {
-      return LIBRARY_TYPE_ERROR;
+   std::vector<std::string> messages;
+   std::string error;
+   std::size_t first = 0, last = 0;
+
+   {
+      std::lock_guard<std::mutex> lock(job.mutex);
+      messages.swap(job.messages);
+      error = job.error;
+      first = job.fetched;
+      last = job.done;
+      job.fetched = job.done;
    }
 
-   try {
-      const auto parsvec = read_list(link);
-      const TSIL_REAL x  = parsvec.at(0);
-      const TSIL_REAL qq = parsvec.at(1);
+   for (const auto& m: messages) {
+      put_message(libData, "TSILInfoMessage", m);
+   }
 
-      TSIL_COMPLEXCPP Ap;
+   if (!error.empty()) {
+      put_message(libData, "TSILErrorMessage", error);
+      return LIBRARY_FUNCTION_ERROR;
+   }
 
-      {
-         Redirect_output rd(link);
-         Ap = TSIL_Ap_(x, qq);
-      }
+   const mint dims[2] = { static_cast<mint>(last - first), NUMBER_OF_RESULTS };
+   MTensor res;
 
-      MLPut(link, Ap);
-   } catch (const std::exception& e) {
-      put_message(link, "TSILErrorMessage", e.what());
-      MLPutSymbol(link, "$Failed");
-   } catch (...) {
-      put_message(link, "TSILErrorMessage", "An unknown exception has been thrown.");
-      MLPutSymbol(link, "$Failed");
+   if (libData->MTensor_new(MType_Complex, 2, dims, &res) != LIBRARY_NO_ERROR) {
+      return LIBRARY_MEMORY_ERROR;
+   }
+
+   mcomplex* out = libData->MTensor_getComplexData(res);
+
+   // the finished results are not modified by the task anymore
+   for (std::size_t i = first; i < last; i++) {
+      put_results(job.results[i], out + (i - first)*NUMBER_OF_RESULTS);
    }
 
+   MArgument_setMTensor(Res, res);
+
    return LIBRARY_NO_ERROR;
 }
 
+} // anonymous namespace
+
+extern "C" {
+
 /******************************************************************/
 
-DLLEXPORT int TSILAeps(WolframLibraryData /* libData */, MLINK link)
+DLLEXPORT int TSILEvaluate(
+   WolframLibraryData /* libData */, MLINK link)
 {
-   if (!check_number_of_args(link, 1, "TSILAeps")) {
-      return LIBRARY_TYPE_ERROR;
+   Trace_scope trace("TSILEvaluate");
+
+   const auto n_args = number_of_args(link, "List");
+
+   if (n_args != 1 && n_args != 2) {
+      diagnostics() << "Error: TSILEvaluate expects 1 or 2 arguments ("
+                    << n_args << " given).\n";
+      return argument_error(link);
    }
 
    try {
-      const auto parsvec = read_list(link);
-      const TSIL_REAL x  = parsvec.at(0);
-      const TSIL_REAL qq = parsvec.at(1);
+      const auto parsvec = read_reals(link);
+
+      if (n_args == 2) {
+         // only the results listed in the 2nd argument
+         const auto wanted = read_strings(link);
+
+         if (MLNewPacket(link) == 0) {
+            throw std::runtime_error("Cannot create new packet!");
+         }
+
+         std::vector<TSIL_COMPLEXCPP> values;
+
+         {
+            trace.phase(Phase::Compute);
+            Capture_diagnostics cd(link);
+            values = calculate_results(make_parameters(parsvec), wanted);
+         }
+
+         trace.phase(Phase::Marshal);
+         put_values(values, wanted, link);
+
+         return LIBRARY_NO_ERROR;
+      }
+
+      if (MLNewPacket(link) == 0) {
+         throw std::runtime_error("Cannot create new packet!");
+      }
 
-      TSIL_COMPLEXCPP Aeps;
+      Results results;
 
       {
-         Redirect_output rd(link);
-         Aeps = TSIL_Aeps_(x, qq);
+         trace.phase(Phase::Compute);
+         Capture_diagnostics cd(link);
+         results = calculate_results(make_parameters(parsvec));
       }
 
-      MLPut(link, Aeps);
+      trace.phase(Phase::Marshal);
+      put_results(results, link);
    } catch (const std::exception& e) {
       put_message(link, "TSILErrorMessage", e.what());
       MLPutSymbol(link, "$Failed");
@@ -442,28 +861,49 @@ DLLEXPORT int TSILAeps(WolframLibraryData /* libData */, MLINK link)
 
 /******************************************************************/
 
-DLLEXPORT int TSILB(WolframLibraryData /* libData */, MLINK link)
+DLLEXPORT int TSILEvaluateArray(
+   WolframLibraryData /* libData */, MLINK link)
 {
-   if (!check_number_of_args(link, 1, "TSILB")) {
-      return LIBRARY_TYPE_ERROR;
+   Trace_scope trace("TSILEvaluateArray");
+
+   const auto n_args = number_of_args(link, "List");
+
+   if (n_args != 2 && n_args != 3) {
+      diagnostics() << "Error: TSILEvaluateArray expects 2 or 3 arguments ("
+                    << n_args << " given).\n";
+      return argument_error(link);
    }
 
    try {
-      const auto parsvec = read_list(link);
-      const TSIL_REAL x  = parsvec.at(0);
-      const TSIL_REAL y  = parsvec.at(1);
-      const TSIL_REAL rs = parsvec.at(2);
-      const TSIL_REAL is = parsvec.at(3);
-      const TSIL_REAL qq = parsvec.at(4);
+      const auto parsvec = read_reals(link);
+      const auto bits = MLRead<int>(link);
+      const auto wanted = n_args == 3 ? read_strings(link) : std::vector<std::string>{};
 
-      TSIL_COMPLEXCPP B;
+      if (MLNewPacket(link) == 0) {
+         throw std::runtime_error("Cannot create new packet!");
+      }
+
+      if (bits != 64 && bits != 128) {
+         throw std::runtime_error("Unsupported output precision Real"
+                                  + std::to_string(bits) + ".");
+      }
+
+      std::vector<TSIL_COMPLEXCPP> values;
 
       {
-         Redirect_output rd(link);
-         B = TSIL_B_(x, y, TSIL_COMPLEXCPP(rs,is), qq);
+         trace.phase(Phase::Compute);
+         Capture_diagnostics cd(link);
+
+         if (n_args == 3) {
+            values = calculate_results(make_parameters(parsvec), wanted);
+         } else {
+            const auto results = calculate_results(make_parameters(parsvec));
+            values.assign(results.begin(), results.end());
+         }
       }
 
-      MLPut(link, B);
+      trace.phase(Phase::Marshal);
+      put_values_array(values, bits, link);
    } catch (const std::exception& e) {
       put_message(link, "TSILErrorMessage", e.what());
       MLPutSymbol(link, "$Failed");
@@ -477,28 +917,40 @@ DLLEXPORT int TSILB(WolframLibraryData /* libData */, MLINK link)
 
 /******************************************************************/
 
-DLLEXPORT int TSILBp(WolframLibraryData /* libData */, MLINK link)
+DLLEXPORT int TSILRescale(
+   WolframLibraryData /* libData */, MLINK link)
 {
-   if (!check_number_of_args(link, 1, "TSILBp")) {
-      return LIBRARY_TYPE_ERROR;
+   Trace_scope trace("TSILRescale");
+
+   if (!check_number_of_args(link, 4, "TSILRescale")) {
+      return argument_error(link);
    }
 
    try {
-      const auto parsvec = read_list(link);
-      const TSIL_REAL x  = parsvec.at(0);
-      const TSIL_REAL y  = parsvec.at(1);
-      const TSIL_REAL rs = parsvec.at(2);
-      const TSIL_REAL is = parsvec.at(3);
-      const TSIL_REAL qq = parsvec.at(4);
+      const auto parsvec = read_reals(link);
+      const auto names = read_strings(link);
+      const auto flat = read_reals(link); // {Re, Im, Re, Im, ...}
+      const auto qq_new = MLRead<TSIL_REAL>(link);
 
-      TSIL_COMPLEXCPP Bp;
+      if (MLNewPacket(link) == 0) {
+         throw std::runtime_error("Cannot create new packet!");
+      }
 
-      {
-         Redirect_output rd(link);
-         Bp = TSIL_Bp_(x, y, TSIL_COMPLEXCPP(rs,is), qq);
+      if (flat.size() != 2*names.size()) {
+         throw std::runtime_error("TSILRescale expects one value per output parameter.");
       }
 
-      MLPut(link, Bp);
+      std::vector<TSIL_COMPLEXCPP> values(names.size());
+
+      for (std::size_t k = 0; k < values.size(); k++) {
+         values[k] = TSIL_COMPLEXCPP(flat[2*k], flat[2*k + 1]);
+      }
+
+      trace.phase(Phase::Compute);
+      const auto rescaled = rescale_results(make_parameters(parsvec), names, values, qq_new);
+
+      trace.phase(Phase::Marshal);
+      put_values(rescaled, names, link);
    } catch (const std::exception& e) {
       put_message(link, "TSILErrorMessage", e.what());
       MLPutSymbol(link, "$Failed");
@@ -512,28 +964,32 @@ DLLEXPORT int TSILBp(WolframLibraryData /* libData */, MLINK link)
 
 /******************************************************************/
 
-DLLEXPORT int TSILdBds(WolframLibraryData /* libData */, MLINK link)
+DLLEXPORT int TSILEvaluateMany(
+   WolframLibraryData /* libData */, MLINK link)
 {
-   if (!check_number_of_args(link, 1, "TSILdBds")) {
-      return LIBRARY_TYPE_ERROR;
+   Trace_scope trace("TSILEvaluateMany");
+
+   if (!check_number_of_args(link, 1, "TSILEvaluateMany")) {
+      return argument_error(link);
    }
 
    try {
-      const auto parsvec = read_list(link);
-      const TSIL_REAL x  = parsvec.at(0);
-      const TSIL_REAL y  = parsvec.at(1);
-      const TSIL_REAL rs = parsvec.at(2);
-      const TSIL_REAL is = parsvec.at(3);
-      const TSIL_REAL qq = parsvec.at(4);
+      const auto integrals = read_integrals(link);
+
+      if (MLNewPacket(link) == 0) {
+         throw std::runtime_error("Cannot create new packet!");
+      }
 
-      TSIL_COMPLEXCPP dBds;
+      std::vector<TSIL_COMPLEXCPP> values;
 
       {
-         Redirect_output rd(link);
-         dBds = TSIL_dBds_(x, y, TSIL_COMPLEXCPP(rs,is), qq);
+         trace.phase(Phase::Compute);
+         Capture_diagnostics cd(link);
+         values = calculate_integrals(integrals);
       }
 
-      MLPut(link, dBds);
+      trace.phase(Phase::Marshal);
+      put_values(values, link);
    } catch (const std::exception& e) {
       put_message(link, "TSILErrorMessage", e.what());
       MLPutSymbol(link, "$Failed");
@@ -547,28 +1003,59 @@ DLLEXPORT int TSILdBds(WolframLibraryData /* libData */, MLINK link)
 
 /******************************************************************/
 
-DLLEXPORT int TSILBeps(WolframLibraryData /* libData */, MLINK link)
+/**
+ * arguments: {Re(m2), Im(m2)}, coefficients {Re(c1), Im(c1), ...},
+ * integrals {{name, {arguments}}, ...}, {tolerance, max. iterations}
+ *
+ * returns {pole, converged, {{s, residual}, ...}}
+ */
+DLLEXPORT int TSILFindPole(
+   WolframLibraryData /* libData */, MLINK link)
 {
-   if (!check_number_of_args(link, 1, "TSILBeps")) {
-      return LIBRARY_TYPE_ERROR;
+   Trace_scope trace("TSILFindPole");
+
+   if (!check_number_of_args(link, 4, "TSILFindPole")) {
+      return argument_error(link);
    }
 
    try {
-      const auto parsvec = read_list(link);
-      const TSIL_REAL x  = parsvec.at(0);
-      const TSIL_REAL y  = parsvec.at(1);
-      const TSIL_REAL rs = parsvec.at(2);
-      const TSIL_REAL is = parsvec.at(3);
-      const TSIL_REAL qq = parsvec.at(4);
+      const auto m2 = read_reals(link);
+      const auto coefficients = read_reals(link);
+      const auto integrals = read_integrals(link);
+      const auto settings = read_list(link);
+
+      if (m2.size() != 2 || settings.size() != 2 ||
+          coefficients.size() != 2*integrals.size()) {
+         throw std::runtime_error("Malformed arguments of TSILFindPole.");
+      }
+
+      std::vector<Pole_term> terms(integrals.size());
+
+      for (std::size_t k = 0; k < terms.size(); k++) {
+         terms[k].coefficient = TSIL_COMPLEXCPP(coefficients[2*k], coefficients[2*k + 1]);
+         terms[k].integral = integrals[k];
+      }
 
-      TSIL_COMPLEXCPP Beps;
+      Pole_result result;
 
       {
-         Redirect_output rd(link);
-         Beps = TSIL_Beps_(x, y, TSIL_COMPLEXCPP(rs,is), qq);
+         trace.phase(Phase::Compute);
+         Capture_diagnostics cd(link);
+         result = find_pole(TSIL_COMPLEXCPP(m2[0], m2[1]), terms,
+                            settings[0], static_cast<int>(settings[1]));
       }
 
-      MLPut(link, Beps);
+      trace.phase(Phase::Marshal);
+      MLPutFunction(link, "List", 3);
+      MLPut(link, result.s);
+      MLPutSymbol(link, result.converged ? "True" : "False");
+      MLPutFunction(link, "List", result.iterations.size());
+
+      for (const auto& it: result.iterations) {
+         MLPutFunction(link, "List", 2);
+         MLPut(link, it.s);
+         MLPut(link, it.residual);
+      }
    } catch (const std::exception& e) {
       put_message(link, "TSILErrorMessage", e.what());
       MLPutSymbol(link, "$Failed");
@@ -582,129 +1069,159 @@ DLLEXPORT int TSILBeps(WolframLibraryData /* libData */, MLINK link)
 
 /******************************************************************/
 
-DLLEXPORT int TSILI(WolframLibraryData /* libData */, MLINK link)
+DLLEXPORT int TSILEvaluateBatch(
+   WolframLibraryData libData, mint Argc, MArgument* Args, MArgument Res)
 {
-   if (!check_number_of_args(link, 1, "TSILI")) {
-      return LIBRARY_TYPE_ERROR;
-   }
+   Trace_scope trace("TSILEvaluateBatch");
 
-   try {
-      const auto parsvec = read_list(link);
-      const TSIL_REAL x  = parsvec.at(0);
-      const TSIL_REAL y  = parsvec.at(1);
-      const TSIL_REAL z  = parsvec.at(2);
-      const TSIL_REAL qq = parsvec.at(3);
+   if (Argc != 1) {
+      return LIBRARY_FUNCTION_ERROR;
+   }
 
-      TSIL_COMPLEXCPP I2;
+   MTensor pars = MArgument_getMTensor(Args[0]);
 
-      {
-         Redirect_output rd(link);
-         I2 = TSIL_I2_(x, y, z, qq);
-      }
+   if (libData->MTensor_getType(pars) != MType_Real) {
+      return LIBRARY_TYPE_ERROR;
+   }
 
-      MLPut(link, I2);
-   } catch (const std::exception& e) {
-      put_message(link, "TSILErrorMessage", e.what());
-      MLPutSymbol(link, "$Failed");
-   } catch (...) {
-      put_message(link, "TSILErrorMessage", "An unknown exception has been thrown.");
-      MLPutSymbol(link, "$Failed");
+   if (libData->MTensor_getRank(pars) != 2) {
+      return LIBRARY_RANK_ERROR;
    }
 
-   return LIBRARY_NO_ERROR;
-}
+   const mint* dims = libData->MTensor_getDimensions(pars);
 
-/******************************************************************/
+   if (dims[1] != NUMBER_OF_PARAMETERS) {
+      return LIBRARY_DIMENSION_ERROR;
+   }
 
-DLLEXPORT int TSILIp(WolframLibraryData /* libData */, MLINK link)
-{
-   if (!check_number_of_args(link, 1, "TSILIp")) {
-      return LIBRARY_TYPE_ERROR;
+   const mint n_points = dims[0];
+   const mint res_dims[2] = { n_points, NUMBER_OF_RESULTS };
+   MTensor res;
+
+   if (libData->MTensor_new(MType_Complex, 2, res_dims, &res) != LIBRARY_NO_ERROR) {
+      return LIBRARY_MEMORY_ERROR;
    }
 
+   const mreal* in = libData->MTensor_getRealData(pars);
+   mcomplex* out = libData->MTensor_getComplexData(res);
+
    try {
-      const auto parsvec = read_list(link);
-      const TSIL_REAL x  = parsvec.at(0);
-      const TSIL_REAL y  = parsvec.at(1);
-      const TSIL_REAL z  = parsvec.at(2);
-      const TSIL_REAL qq = parsvec.at(3);
+      Capture_diagnostics cd(libData);
 
-      TSIL_COMPLEXCPP I2p;
+      std::vector<Parameters> points(n_points);
 
-      {
-         Redirect_output rd(link);
-         I2p = TSIL_I2p_(x, y, z, qq);
+      for (mint i = 0; i < n_points; i++) {
+         std::copy(in + i*NUMBER_OF_PARAMETERS, in + (i + 1)*NUMBER_OF_PARAMETERS, points[i].begin());
+      }
+
+      // diagnostic output of each point
+      std::vector<std::string> messages;
+      std::vector<Results> results;
+
+      trace.phase(Phase::Compute);
+      const auto done = calculate_results_in_chunks(
+         points, results, [libData] { return libData->AbortQ() != 0; }, &messages);
+
+      trace.phase(Phase::Marshal);
+      for (std::size_t i = 0; i < done; i++) {
+         for_each_line(messages[i], [i] (const std::string& line) {
+            diagnostics() << "Point " << (i + 1) << ": " << line << '\n';
+         });
+      }
+
+      // the kernel discards the result of an aborted call, so the
+      // finished points are kept for TSILTakePartialResults
+      if (done < static_cast<std::size_t>(n_points)) {
+         results.resize(done);
+         std::lock_guard<std::mutex> lock(partial_results_mutex);
+         partial_results = std::move(results);
+         libData->MTensor_free(res);
+         return LIBRARY_FUNCTION_ERROR;
       }
 
-      MLPut(link, I2p);
+      for (mint i = 0; i < n_points; i++) {
+         put_results(results[i], out + i*NUMBER_OF_RESULTS);
+      }
    } catch (const std::exception& e) {
-      put_message(link, "TSILErrorMessage", e.what());
-      MLPutSymbol(link, "$Failed");
+      libData->MTensor_free(res);
+      put_message(libData, "TSILErrorMessage", e.what());
+      return LIBRARY_FUNCTION_ERROR;
    } catch (...) {
-      put_message(link, "TSILErrorMessage", "An unknown exception has been thrown.");
-      MLPutSymbol(link, "$Failed");
+      libData->MTensor_free(res);
+      put_message(libData, "TSILErrorMessage", "An unknown exception has been thrown.");
+      return LIBRARY_FUNCTION_ERROR;
    }
 
+   MArgument_setMTensor(Res, res);
+
    return LIBRARY_NO_ERROR;
 }
 
 /******************************************************************/
 
-DLLEXPORT int TSILIp2(WolframLibraryData /* libData */, MLINK link)
+/// returns and removes the finished points of the last aborted TSILEvaluateBatch
+DLLEXPORT int TSILTakePartialResults(
+   WolframLibraryData libData, mint Argc, MArgument* /* Args */, MArgument Res)
 {
-   if (!check_number_of_args(link, 1, "TSILIp2")) {
-      return LIBRARY_TYPE_ERROR;
+   if (Argc != 0) {
+      return LIBRARY_FUNCTION_ERROR;
    }
 
-   try {
-      const auto parsvec = read_list(link);
-      const TSIL_REAL x  = parsvec.at(0);
-      const TSIL_REAL y  = parsvec.at(1);
-      const TSIL_REAL z  = parsvec.at(2);
-      const TSIL_REAL qq = parsvec.at(3);
+   std::vector<Results> results;
 
-      TSIL_COMPLEXCPP I2p2;
+   {
+      std::lock_guard<std::mutex> lock(partial_results_mutex);
+      results.swap(partial_results);
+   }
 
-      {
-         Redirect_output rd(link);
-         I2p2 = TSIL_I2p2_(x, y, z, qq);
-      }
+   const mint dims[2] = { static_cast<mint>(results.size()), NUMBER_OF_RESULTS };
+   MTensor res;
 
-      MLPut(link, I2p2);
-   } catch (const std::exception& e) {
-      put_message(link, "TSILErrorMessage", e.what());
-      MLPutSymbol(link, "$Failed");
-   } catch (...) {
-      put_message(link, "TSILErrorMessage", "An unknown exception has been thrown.");
-      MLPutSymbol(link, "$Failed");
+   if (libData->MTensor_new(MType_Complex, 2, dims, &res) != LIBRARY_NO_ERROR) {
+      return LIBRARY_MEMORY_ERROR;
+   }
+
+   mcomplex* out = libData->MTensor_getComplexData(res);
+
+   for (std::size_t i = 0; i < results.size(); i++) {
+      put_results(results[i], out + i*NUMBER_OF_RESULTS);
    }
 
+   MArgument_setMTensor(Res, res);
+
    return LIBRARY_NO_ERROR;
 }
 
 /******************************************************************/
 
-DLLEXPORT int TSILIpp(WolframLibraryData /* libData */, MLINK link)
+/// arguments: {socket} (empty for the default socket), returns the socket
+DLLEXPORT int TSILConnect(
+   WolframLibraryData /* libData */, MLINK link)
 {
-   if (!check_number_of_args(link, 1, "TSILIpp")) {
-      return LIBRARY_TYPE_ERROR;
+   if (!check_number_of_args(link, 1, "TSILConnect")) {
+      return argument_error(link);
    }
 
    try {
-      const auto parsvec = read_list(link);
-      const TSIL_REAL x  = parsvec.at(0);
-      const TSIL_REAL y  = parsvec.at(1);
-      const TSIL_REAL z  = parsvec.at(2);
-      const TSIL_REAL qq = parsvec.at(3);
+      const auto args = read_strings(link);
+
+      if (MLNewPacket(link) == 0) {
+         throw std::runtime_error("Cannot create new packet!");
+      }
 
-      TSIL_COMPLEXCPP I2pp;
+      if (args.size() != 1) {
+         throw std::runtime_error("TSILConnect expects the path of a socket.");
+      }
+
+      const auto path = args.front().empty() ? default_socket_path() : args.front();
+      auto connection = std::make_shared<Server_connection>(connect_to_server(path));
 
       {
-         Redirect_output rd(link);
-         I2pp = TSIL_I2pp_(x, y, z, qq);
+         std::lock_guard<std::mutex> lock(server_mutex);
+         server = std::move(connection);
       }
 
-      MLPut(link, I2pp);
+      MLPutString(link, path.c_str());
    } catch (const std::exception& e) {
       put_message(link, "TSILErrorMessage", e.what());
       MLPutSymbol(link, "$Failed");
@@ -718,260 +1235,334 @@ DLLEXPORT int TSILIpp(WolframLibraryData /* libData */, MLINK link)
 
 /******************************************************************/
 
-DLLEXPORT int TSILIp3(WolframLibraryData /* libData */, MLINK link)
+DLLEXPORT int TSILDisconnect(
+   WolframLibraryData /* libData */, mint Argc, MArgument* /* Args */, MArgument /* Res */)
 {
-   if (!check_number_of_args(link, 1, "TSILIp3")) {
-      return LIBRARY_TYPE_ERROR;
+   if (Argc != 0) {
+      return LIBRARY_FUNCTION_ERROR;
    }
 
-   try {
-      const auto parsvec = read_list(link);
-      const TSIL_REAL x  = parsvec.at(0);
-      const TSIL_REAL y  = parsvec.at(1);
-      const TSIL_REAL z  = parsvec.at(2);
-      const TSIL_REAL qq = parsvec.at(3);
-
-      TSIL_COMPLEXCPP I2p3;
-
-      {
-         Redirect_output rd(link);
-         I2p3 = TSIL_I2p3_(x, y, z, qq);
-      }
-
-      MLPut(link, I2p3);
-   } catch (const std::exception& e) {
-      put_message(link, "TSILErrorMessage", e.what());
-      MLPutSymbol(link, "$Failed");
-   } catch (...) {
-      put_message(link, "TSILErrorMessage", "An unknown exception has been thrown.");
-      MLPutSymbol(link, "$Failed");
-   }
+   disconnect_from_server();
 
    return LIBRARY_NO_ERROR;
 }
 
 /******************************************************************/
 
-DLLEXPORT int TSILM(WolframLibraryData /* libData */, MLINK link)
+/**
+ * Same as TSILEvaluateBatch, but the points are sent to the connected
+ * tsil-mma-server in chunks of REMOTE_CHUNK_SIZE points.  The
+ * connection is not locked globally during the requests, so that
+ * TSILConnect and TSILDisconnect do not wait for the server.
+ */
+DLLEXPORT int TSILRemoteEvaluateBatch(
+   WolframLibraryData libData, mint Argc, MArgument* Args, MArgument Res)
 {
-   if (!check_number_of_args(link, 1, "TSILM")) {
+   Trace_scope trace("TSILRemoteEvaluateBatch");
+
+   if (Argc != 1) {
+      return LIBRARY_FUNCTION_ERROR;
+   }
+
+   MTensor pars = MArgument_getMTensor(Args[0]);
+
+   if (libData->MTensor_getType(pars) != MType_Real) {
       return LIBRARY_TYPE_ERROR;
    }
 
+   if (libData->MTensor_getRank(pars) != 2) {
+      return LIBRARY_RANK_ERROR;
+   }
+
+   const mint* dims = libData->MTensor_getDimensions(pars);
+
+   if (dims[1] != NUMBER_OF_PARAMETERS) {
+      return LIBRARY_DIMENSION_ERROR;
+   }
+
+   const auto n_points = static_cast<std::size_t>(dims[0]);
+   const mint res_dims[2] = { dims[0], NUMBER_OF_RESULTS };
+   MTensor res;
+
+   if (libData->MTensor_new(MType_Complex, 2, res_dims, &res) != LIBRARY_NO_ERROR) {
+      return LIBRARY_MEMORY_ERROR;
+   }
+
+   const mreal* in = libData->MTensor_getRealData(pars);
+   mcomplex* out = libData->MTensor_getComplexData(res);
+
+   const auto connection = get_server();
+
    try {
-      const auto parsvec = read_list(link);
-      const TSIL_REAL x  = parsvec.at(0);
-      const TSIL_REAL y  = parsvec.at(1);
-      const TSIL_REAL z  = parsvec.at(2);
-      const TSIL_REAL u  = parsvec.at(3);
-      const TSIL_REAL v  = parsvec.at(4);
-      const TSIL_REAL rs = parsvec.at(5);
-      const TSIL_REAL is = parsvec.at(6);
+      if (!connection) {
+         throw std::runtime_error("Not connected to tsil-mma-server, call TSILConnect.");
+      }
 
-      TSIL_COMPLEXCPP M;
+      Capture_diagnostics cd(libData);
+      std::lock_guard<std::mutex> lock(connection->mutex);
+      std::size_t done = 0;
 
-      {
-         Redirect_output rd(link);
+      while (done < n_points && libData->AbortQ() == 0) {
+         const auto n = std::min(REMOTE_CHUNK_SIZE, n_points - done);
+         std::vector<std::string> messages;
 
-         const auto is_analytic = TSIL_Manalytic_(x, y, z, u, v, TSIL_COMPLEXCPP(rs,is), &M);
+         trace.phase(Phase::Compute);
+         const auto values = evaluate_remote(connection->fd, in + done*NUMBER_OF_PARAMETERS, n, &messages);
 
-         if (is_analytic == 0) {
-            const TSIL_REAL qq = 1; // M is independent of qq
-            TSIL_DATA data{};
-            TSIL_SetParameters_(&data, x, y, z, u, v, qq);
-            TSIL_Evaluate_(&data, rs);
-            M = TSIL_GetFunction_(&data, "M");
+         trace.phase(Phase::Marshal);
+         for (std::size_t i = 0; i < n*NUMBER_OF_RESULTS; i++) {
+            mcreal(out[done*NUMBER_OF_RESULTS + i]) = values[2*i];
+            mcimag(out[done*NUMBER_OF_RESULTS + i]) = values[2*i + 1];
          }
+
+         for (std::size_t i = 0; i < n; i++) {
+            for_each_line(messages[i], [i, done] (const std::string& line) {
+               diagnostics() << "Point " << (done + i + 1) << ": " << line << '\n';
+            });
+         }
+
+         done += n;
       }
 
-      MLPut(link, M);
+      // as in TSILEvaluateBatch, the finished points of an aborted
+      // call are kept for TSILTakePartialResults
+      if (done < n_points) {
+         std::vector<Results> results(done);
+         for (std::size_t i = 0; i < done; i++) {
+            for (int k = 0; k < NUMBER_OF_RESULTS; k++) {
+               const mcomplex& c = out[i*NUMBER_OF_RESULTS + k];
+               results[i][k] = TSIL_COMPLEXCPP(mcreal(c), mcimag(c));
+            }
+         }
+         std::lock_guard<std::mutex> lock_partial(partial_results_mutex);
+         partial_results = std::move(results);
+         libData->MTensor_free(res);
+         return LIBRARY_FUNCTION_ERROR;
+      }
+   } catch (const Server_error& e) {
+      libData->MTensor_free(res);
+      put_message(libData, "TSILErrorMessage", e.what());
+      return LIBRARY_FUNCTION_ERROR;
    } catch (const std::exception& e) {
-      put_message(link, "TSILErrorMessage", e.what());
-      MLPutSymbol(link, "$Failed");
+      // the connection is in an undefined state
+      {
+         std::lock_guard<std::mutex> lock(server_mutex);
+         if (server == connection) {
+            server.reset();
+         }
+      }
+      libData->MTensor_free(res);
+      put_message(libData, "TSILErrorMessage", e.what());
+      return LIBRARY_FUNCTION_ERROR;
    } catch (...) {
-      put_message(link, "TSILErrorMessage", "An unknown exception has been thrown.");
-      MLPutSymbol(link, "$Failed");
+      libData->MTensor_free(res);
+      put_message(libData, "TSILErrorMessage", "An unknown exception has been thrown.");
+      return LIBRARY_FUNCTION_ERROR;
    }
 
+   MArgument_setMTensor(Res, res);
+
    return LIBRARY_NO_ERROR;
 }
 
 /******************************************************************/
 
-DLLEXPORT int TSILS(WolframLibraryData /* libData */, MLINK link)
+/// arguments: N x 8 parameter points and the chunk size (0 = automatic)
+DLLEXPORT int TSILSubmit(
+   WolframLibraryData libData, mint Argc, MArgument* Args, MArgument Res)
 {
-   if (!check_number_of_args(link, 1, "TSILS")) {
+   Trace_scope trace("TSILSubmit");
+
+   if (Argc != 2) {
+      return LIBRARY_FUNCTION_ERROR;
+   }
+
+   MTensor pars = MArgument_getMTensor(Args[0]);
+   const mint chunk_size = MArgument_getInteger(Args[1]);
+
+   if (libData->MTensor_getType(pars) != MType_Real) {
       return LIBRARY_TYPE_ERROR;
    }
 
-   try {
-      const auto parsvec = read_list(link);
-      const TSIL_REAL x  = parsvec.at(0);
-      const TSIL_REAL y  = parsvec.at(1);
-      const TSIL_REAL z  = parsvec.at(2);
-      const TSIL_REAL rs = parsvec.at(3);
-      const TSIL_REAL is = parsvec.at(4);
-      const TSIL_REAL qq = parsvec.at(5);
+   if (libData->MTensor_getRank(pars) != 2) {
+      return LIBRARY_RANK_ERROR;
+   }
 
-      TSIL_COMPLEXCPP S;
+   const mint* dims = libData->MTensor_getDimensions(pars);
 
-      {
-         Redirect_output rd(link);
+   if (dims[1] != NUMBER_OF_PARAMETERS || chunk_size < 0) {
+      return LIBRARY_DIMENSION_ERROR;
+   }
 
-         const auto is_analytic = TSIL_Sanalytic_(x, y, z, TSIL_COMPLEXCPP(rs,is), qq, &S);
+   const mint n_points = dims[0];
+   const mreal* in = libData->MTensor_getRealData(pars);
+   auto job = std::make_shared<Job>();
 
-         if (is_analytic == 0) {
-            const TSIL_REAL d = 1;
-            TSIL_DATA data{};
-            TSIL_SetParameters_(&data, d, y, z, d, x, qq);
-            TSIL_Evaluate_(&data, rs);
-            S = TSIL_GetFunction_(&data, "Svyz");
-         }
-      }
+   job->io = libData->ioLibraryFunctions;
+   job->points.resize(n_points);
+   job->results.resize(n_points);
+   // a few points per thread, so that the threads are balanced
+   job->chunk_size = chunk_size > 0 ? static_cast<std::size_t>(chunk_size) : 8*get_number_of_threads();
 
-      MLPut(link, S);
-   } catch (const std::exception& e) {
-      put_message(link, "TSILErrorMessage", e.what());
-      MLPutSymbol(link, "$Failed");
-   } catch (...) {
-      put_message(link, "TSILErrorMessage", "An unknown exception has been thrown.");
-      MLPutSymbol(link, "$Failed");
+   for (mint i = 0; i < n_points; i++) {
+      std::copy(in + i*NUMBER_OF_PARAMETERS, in + (i + 1)*NUMBER_OF_PARAMETERS, job->points[i].begin());
+   }
+
+   trace.phase(Phase::Compute);
+
+   // the task owns a copy of the shared pointer
+   const mint id = job->io->createAsynchronousTaskWithThread(run_job, new std::shared_ptr<Job>(job));
+
+   {
+      std::lock_guard<std::mutex> lock(jobs_mutex);
+      if (!job->removed) {
+         jobs[id] = std::move(job);
+      }
    }
 
+   trace.phase(Phase::Marshal);
+   MArgument_setInteger(Res, id);
+
    return LIBRARY_NO_ERROR;
 }
 
 /******************************************************************/
 
-DLLEXPORT int TSILT(WolframLibraryData /* libData */, MLINK link)
+/**
+ * Returns {number of finished points, number of points, 1 if the task
+ * has finished, number of points returned by TSILPoll}.
+ */
+DLLEXPORT int TSILTaskStatus(
+   WolframLibraryData libData, mint Argc, MArgument* Args, MArgument Res)
 {
-   if (!check_number_of_args(link, 1, "TSILT")) {
-      return LIBRARY_TYPE_ERROR;
+   if (Argc != 1) {
+      return LIBRARY_FUNCTION_ERROR;
    }
 
-   try {
-      const auto parsvec = read_list(link);
-      const TSIL_REAL x  = parsvec.at(0);
-      const TSIL_REAL y  = parsvec.at(1);
-      const TSIL_REAL z  = parsvec.at(2);
-      const TSIL_REAL rs = parsvec.at(3);
-      const TSIL_REAL is = parsvec.at(4);
-      const TSIL_REAL qq = parsvec.at(5);
+   std::shared_ptr<Job> job;
 
-      TSIL_COMPLEXCPP T;
+   try {
+      job = find_job(MArgument_getInteger(Args[0]));
+   } catch (const std::exception& e) {
+      put_message(libData, "TSILErrorMessage", e.what());
+      return LIBRARY_FUNCTION_ERROR;
+   }
 
-      {
-         Redirect_output rd(link);
+   const mint dims[1] = { 4 };
+   MTensor res;
 
-         const auto is_analytic = TSIL_Tanalytic_(x, y, z, TSIL_COMPLEXCPP(rs,is), qq, &T);
+   if (libData->MTensor_new(MType_Integer, 1, dims, &res) != LIBRARY_NO_ERROR) {
+      return LIBRARY_MEMORY_ERROR;
+   }
 
-         if (is_analytic == 0) {
-            const TSIL_REAL d = 1;
-            TSIL_DATA data{};
-            TSIL_SetParameters_(&data, d, y, z, d, x, qq);
-            TSIL_Evaluate_(&data, rs);
-            T = TSIL_GetFunction_(&data, "Tvyz");
-         }
-      }
+   mint* data = libData->MTensor_getIntegerData(res);
 
-      MLPut(link, T);
-   } catch (const std::exception& e) {
-      put_message(link, "TSILErrorMessage", e.what());
-      MLPutSymbol(link, "$Failed");
-   } catch (...) {
-      put_message(link, "TSILErrorMessage", "An unknown exception has been thrown.");
-      MLPutSymbol(link, "$Failed");
+   {
+      std::lock_guard<std::mutex> lock(job->mutex);
+      data[0] = static_cast<mint>(job->done);
+      data[1] = static_cast<mint>(job->points.size());
+      data[2] = job->finished ? 1 : 0;
+      data[3] = static_cast<mint>(job->fetched);
    }
 
+   MArgument_setMTensor(Res, res);
+
    return LIBRARY_NO_ERROR;
 }
 
 /******************************************************************/
 
-DLLEXPORT int TSILTbar(WolframLibraryData /* libData */, MLINK link)
+/// returns the points finished since the last call of TSILPoll
+DLLEXPORT int TSILPoll(
+   WolframLibraryData libData, mint Argc, MArgument* Args, MArgument Res)
 {
-   if (!check_number_of_args(link, 1, "TSILTbar")) {
-      return LIBRARY_TYPE_ERROR;
+   Trace_scope trace("TSILPoll");
+
+   if (Argc != 1) {
+      return LIBRARY_FUNCTION_ERROR;
    }
 
    try {
-      const auto parsvec = read_list(link);
-      const TSIL_REAL x  = parsvec.at(0);
-      const TSIL_REAL y  = parsvec.at(1);
-      const TSIL_REAL z  = parsvec.at(2);
-      const TSIL_REAL rs = parsvec.at(3);
-      const TSIL_REAL is = parsvec.at(4);
-      const TSIL_REAL qq = parsvec.at(5);
+      const auto job = find_job(MArgument_getInteger(Args[0]));
+      trace.phase(Phase::Marshal);
+      return fetch_job_results(libData, *job, Res);
+   } catch (const std::exception& e) {
+      put_message(libData, "TSILErrorMessage", e.what());
+      return LIBRARY_FUNCTION_ERROR;
+   }
+}
 
-      TSIL_COMPLEXCPP Tbar;
+/******************************************************************/
 
-      {
-         Redirect_output rd(link);
+/**
+ * Waits until the task has finished and returns the points that have
+ * not been returned by TSILPoll.  The wait can be aborted, which
+ * cancels the task.
+ */
+DLLEXPORT int TSILCollect(
+   WolframLibraryData libData, mint Argc, MArgument* Args, MArgument Res)
+{
+   Trace_scope trace("TSILCollect");
+
+   if (Argc != 1) {
+      return LIBRARY_FUNCTION_ERROR;
+   }
+
+   const mint id = MArgument_getInteger(Args[0]);
 
-         const auto is_analytic = TSIL_Tbaranalytic_(x, y, z, TSIL_COMPLEXCPP(rs,is), qq, &Tbar);
+   try {
+      const auto job = find_job(id);
+
+      trace.phase(Phase::Compute);
 
-         if (is_analytic == 0) {
-            const TSIL_REAL d = 1;
-            TSIL_DATA data{};
-            TSIL_SetParameters_(&data, d, y, z, d, x, qq);
-            TSIL_Evaluate_(&data, rs);
-            Tbar = TSIL_GetFunction_(&data, "TBARvyz");
+      {
+         std::unique_lock<std::mutex> lock(job->mutex);
+         while (!job->finished) {
+            job->progress.wait_for(lock, std::chrono::milliseconds(50));
+            if (libData->AbortQ()) {
+               lock.unlock();
+               release_job(id, *job);
+               return LIBRARY_FUNCTION_ERROR;
+            }
          }
       }
 
-      MLPut(link, Tbar);
+      {
+         std::lock_guard<std::mutex> lock(jobs_mutex);
+         jobs.erase(id);
+      }
+
+      trace.phase(Phase::Marshal);
+      return fetch_job_results(libData, *job, Res);
    } catch (const std::exception& e) {
-      put_message(link, "TSILErrorMessage", e.what());
-      MLPutSymbol(link, "$Failed");
-   } catch (...) {
-      put_message(link, "TSILErrorMessage", "An unknown exception has been thrown.");
-      MLPutSymbol(link, "$Failed");
+      put_message(libData, "TSILErrorMessage", e.what());
+      return LIBRARY_FUNCTION_ERROR;
    }
-
-   return LIBRARY_NO_ERROR;
 }
 
 /******************************************************************/
 
-DLLEXPORT int TSILU(WolframLibraryData /* libData */, MLINK link)
+/// stops the task after the current chunk and releases its results
+DLLEXPORT int TSILCancelTask(
+   WolframLibraryData /* libData */, mint Argc, MArgument* Args, MArgument /* Res */)
 {
-   if (!check_number_of_args(link, 1, "TSILU")) {
-      return LIBRARY_TYPE_ERROR;
+   if (Argc != 1) {
+      return LIBRARY_FUNCTION_ERROR;
    }
 
-   try {
-      const auto parsvec = read_list(link);
-      const TSIL_REAL x  = parsvec.at(0);
-      const TSIL_REAL y  = parsvec.at(1);
-      const TSIL_REAL z  = parsvec.at(2);
-      const TSIL_REAL u  = parsvec.at(3);
-      const TSIL_REAL rs = parsvec.at(4);
-      const TSIL_REAL is = parsvec.at(5);
-      const TSIL_REAL qq = parsvec.at(6);
-
-      TSIL_COMPLEXCPP U;
-
-      {
-         Redirect_output rd(link);
-
-         const auto is_analytic = TSIL_Uanalytic_(x, y, z, u, TSIL_COMPLEXCPP(rs,is), qq, &U);
+   const mint id = MArgument_getInteger(Args[0]);
+   std::shared_ptr<Job> job;
 
-         if (is_analytic == 0) {
-            const TSIL_REAL d = 1;
-            TSIL_DATA data{};
-            TSIL_SetParameters_(&data, y, z, x, d, u, qq);
-            TSIL_Evaluate_(&data, rs);
-            U = TSIL_GetFunction_(&data, "Uzxyv");
-         }
+   {
+      std::lock_guard<std::mutex> lock(jobs_mutex);
+      const auto it = jobs.find(id);
+      if (it != jobs.end()) {
+         job = it->second;
       }
+   }
 
-      MLPut(link, U);
-   } catch (const std::exception& e) {
-      put_message(link, "TSILErrorMessage", e.what());
-      MLPutSymbol(link, "$Failed");
-   } catch (...) {
-      put_message(link, "TSILErrorMessage", "An unknown exception has been thrown.");
-      MLPutSymbol(link, "$Failed");
+   if (job) {
+      release_job(id, *job);
    }
 
    return LIBRARY_NO_ERROR;
@@ -979,62 +1570,825 @@ DLLEXPORT int TSILU(WolframLibraryData /* libData */, MLINK link)
 
 /******************************************************************/
 
-DLLEXPORT int TSILV(WolframLibraryData /* libData */, MLINK link)
+DLLEXPORT int TSILEstimateErrors(
+   WolframLibraryData libData, mint Argc, MArgument* Args, MArgument Res)
 {
-   if (!check_number_of_args(link, 1, "TSILV")) {
+   Trace_scope trace("TSILEstimateErrors");
+
+   if (Argc != 2) {
+      return LIBRARY_FUNCTION_ERROR;
+   }
+
+   MTensor pars = MArgument_getMTensor(Args[0]);
+   MTensor vals = MArgument_getMTensor(Args[1]);
+
+   if (libData->MTensor_getType(pars) != MType_Real ||
+       libData->MTensor_getType(vals) != MType_Complex) {
       return LIBRARY_TYPE_ERROR;
    }
 
-   try {
-      const auto parsvec = read_list(link);
-      const TSIL_REAL x  = parsvec.at(0);
-      const TSIL_REAL y  = parsvec.at(1);
-      const TSIL_REAL z  = parsvec.at(2);
-      const TSIL_REAL u  = parsvec.at(3);
-      const TSIL_REAL rs = parsvec.at(4);
-      const TSIL_REAL is = parsvec.at(5);
-      const TSIL_REAL qq = parsvec.at(6);
+   if (libData->MTensor_getRank(pars) != 2 || libData->MTensor_getRank(vals) != 2) {
+      return LIBRARY_RANK_ERROR;
+   }
 
-      TSIL_COMPLEXCPP V;
+   const mint* pars_dims = libData->MTensor_getDimensions(pars);
+   const mint* vals_dims = libData->MTensor_getDimensions(vals);
 
-      {
-         Redirect_output rd(link);
+   if (pars_dims[1] != NUMBER_OF_PARAMETERS || vals_dims[1] != NUMBER_OF_RESULTS ||
+       pars_dims[0] != vals_dims[0]) {
+      return LIBRARY_DIMENSION_ERROR;
+   }
 
-         const auto is_analytic = TSIL_Vanalytic_(x, y, z, u, TSIL_COMPLEXCPP(rs,is), qq, &V);
+   const mint n_points = pars_dims[0];
+   MTensor res;
 
-         if (is_analytic == 0) {
-            const TSIL_REAL d = 1;
-            TSIL_DATA data{};
-            TSIL_SetParameters_(&data, y, z, x, d, u, qq);
-            TSIL_Evaluate_(&data, rs);
-            V = TSIL_GetFunction_(&data, "Vzxyv");
-         }
+   if (libData->MTensor_new(MType_Real, 1, &n_points, &res) != LIBRARY_NO_ERROR) {
+      return LIBRARY_MEMORY_ERROR;
+   }
+
+   const mreal* in = libData->MTensor_getRealData(pars);
+   const mcomplex* in_vals = libData->MTensor_getComplexData(vals);
+   mreal* out = libData->MTensor_getRealData(res);
+
+   trace.phase(Phase::Compute);
+
+   for (mint i = 0; i < n_points; i++) {
+      Parameters point;
+      Results results;
+
+      std::copy(in + i*NUMBER_OF_PARAMETERS, in + (i + 1)*NUMBER_OF_PARAMETERS, point.begin());
+
+      for (int k = 0; k < NUMBER_OF_RESULTS; k++) {
+         const mcomplex& c = in_vals[i*NUMBER_OF_RESULTS + k];
+         results[k] = TSIL_COMPLEXCPP(mcreal(c), mcimag(c));
       }
 
-      MLPut(link, V);
-   } catch (const std::exception& e) {
-      put_message(link, "TSILErrorMessage", e.what());
-      MLPutSymbol(link, "$Failed");
-   } catch (...) {
-      put_message(link, "TSILErrorMessage", "An unknown exception has been thrown.");
-      MLPutSymbol(link, "$Failed");
+      // an infinite error is returned as the largest machine number
+      out[i] = static_cast<mreal>(
+         std::min(estimate_error(point, results),
+                  static_cast<TSIL_REAL>(std::numeric_limits<mreal>::max())));
    }
 
+   trace.phase(Phase::Marshal);
+   MArgument_setMTensor(Res, res);
+
    return LIBRARY_NO_ERROR;
 }
 
 /******************************************************************/
 
-DLLEXPORT mint WolframLibrary_getVersion()
+DLLEXPORT int TSILEvaluateSweep(
+   WolframLibraryData libData, mint Argc, MArgument* Args, MArgument Res)
 {
-   return WolframLibraryVersion;
-}
+   Trace_scope trace("TSILEvaluateSweep");
 
-/******************************************************************/
+   if (Argc != 2) {
+      return LIBRARY_FUNCTION_ERROR;
+   }
 
-DLLEXPORT int WolframLibrary_initialize(WolframLibraryData /* libData */)
-{
-   return LIBRARY_NO_ERROR;
+   MTensor pars = MArgument_getMTensor(Args[0]);
+   MTensor svals = MArgument_getMTensor(Args[1]);
+
+   if (libData->MTensor_getType(pars) != MType_Real ||
+       libData->MTensor_getType(svals) != MType_Complex) {
+      return LIBRARY_TYPE_ERROR;
+   }
+
+   if (libData->MTensor_getRank(pars) != 1 || libData->MTensor_getRank(svals) != 1) {
+      return LIBRARY_RANK_ERROR;
+   }
+
+   // {x, y, z, u, v, qq}
+   if (libData->MTensor_getDimensions(pars)[0] != NUMBER_OF_PARAMETERS - 2) {
+      return LIBRARY_DIMENSION_ERROR;
+   }
+
+   const mint n_points = libData->MTensor_getDimensions(svals)[0];
+   const mint res_dims[2] = { n_points, NUMBER_OF_RESULTS };
+   MTensor res;
+
+   if (libData->MTensor_new(MType_Complex, 2, res_dims, &res) != LIBRARY_NO_ERROR) {
+      return LIBRARY_MEMORY_ERROR;
+   }
+
+   const mreal* in = libData->MTensor_getRealData(pars);
+   const mcomplex* s_in = libData->MTensor_getComplexData(svals);
+   mcomplex* out = libData->MTensor_getComplexData(res);
+
+   try {
+      Capture_diagnostics cd(libData);
+
+      const Parameters parsvec{in[0], in[1], in[2], in[3], in[4], 0, 0, in[5]};
+      std::vector<TSIL_COMPLEXCPP> s(n_points);
+
+      for (mint i = 0; i < n_points; i++) {
+         s[i] = TSIL_COMPLEXCPP(mcreal(s_in[i]), mcimag(s_in[i]));
+      }
+
+      // diagnostic output of each point
+      std::vector<std::string> messages;
+
+      trace.phase(Phase::Compute);
+      const auto results = calculate_sweep(parsvec, s, &messages);
+
+      trace.phase(Phase::Marshal);
+      for (mint i = 0; i < n_points; i++) {
+         put_results(results[i], out + i*NUMBER_OF_RESULTS);
+         for_each_line(messages[i], [i] (const std::string& line) {
+            diagnostics() << "Point " << (i + 1) << ": " << line << '\n';
+         });
+      }
+   } catch (const std::exception& e) {
+      libData->MTensor_free(res);
+      put_message(libData, "TSILErrorMessage", e.what());
+      return LIBRARY_FUNCTION_ERROR;
+   } catch (...) {
+      libData->MTensor_free(res);
+      put_message(libData, "TSILErrorMessage", "An unknown exception has been thrown.");
+      return LIBRARY_FUNCTION_ERROR;
+   }
+
+   MArgument_setMTensor(Res, res);
+
+   return LIBRARY_NO_ERROR;
+}
+
+/******************************************************************/
+
+/// arguments: session ID, {x, y, z, u, v, qq}
+DLLEXPORT int TSILSessionInit(
+   WolframLibraryData /* libData */, MLINK link)
+{
+   Trace_scope trace("TSILSessionInit");
+
+   if (!check_number_of_args(link, 2, "TSILSessionInit")) {
+      return argument_error(link);
+   }
+
+   try {
+      const mint id = MLRead<mlint64>(link);
+      const auto p = read_list(link);
+
+      if (p.size() != NUMBER_OF_PARAMETERS - 2) {
+         throw std::runtime_error(
+            "TSILSessionCreate expects 6 parameters, but " + std::to_string(p.size()) + " are given.");
+      }
+
+      trace.phase(Phase::Compute);
+      auto session = std::make_shared<Session>(p[0], p[1], p[2], p[3], p[4], p[5]);
+
+      {
+         std::lock_guard<std::mutex> lock(sessions_mutex);
+         sessions[id] = std::move(session);
+      }
+
+      trace.phase(Phase::Marshal);
+      MLPutSymbol(link, "Null");
+   } catch (const std::exception& e) {
+      put_message(link, "TSILErrorMessage", e.what());
+      MLPutSymbol(link, "$Failed");
+   } catch (...) {
+      put_message(link, "TSILErrorMessage", "An unknown exception has been thrown.");
+      MLPutSymbol(link, "$Failed");
+   }
+
+   return LIBRARY_NO_ERROR;
+}
+
+/// arguments: session ID, {Re(s), Im(s)} and optionally the wanted names
+DLLEXPORT int TSILSessionEvaluate(
+   WolframLibraryData /* libData */, MLINK link)
+{
+   Trace_scope trace("TSILSessionEvaluate");
+
+   const auto n_args = number_of_args(link, "List");
+
+   if (n_args != 2 && n_args != 3) {
+      diagnostics() << "Error: TSILSessionEvaluate expects 2 or 3 arguments ("
+                    << n_args << " given).\n";
+      return argument_error(link);
+   }
+
+   try {
+      const mint id = MLRead<mlint64>(link);
+      const auto svec = read_reals(link);
+      const auto wanted = n_args == 3 ? read_strings(link) : std::vector<std::string>{};
+
+      if (MLNewPacket(link) == 0) {
+         throw std::runtime_error("Cannot create new packet!");
+      }
+
+      if (svec.size() != 2) {
+         throw std::runtime_error("TSILSessionEvaluate expects s as {Re(s), Im(s)}.");
+      }
+
+      const auto session = find_session(id);
+      const TSIL_COMPLEXCPP s(svec[0], svec[1]);
+
+      if (n_args == 3) {
+         std::vector<TSIL_COMPLEXCPP> values;
+
+         {
+            trace.phase(Phase::Compute);
+            Capture_diagnostics cd(link);
+            values = session->evaluate(s, wanted);
+         }
+
+         trace.phase(Phase::Marshal);
+         put_values(values, wanted, link);
+      } else {
+         Results results;
+
+         {
+            trace.phase(Phase::Compute);
+            Capture_diagnostics cd(link);
+            results = session->evaluate(s);
+         }
+
+         trace.phase(Phase::Marshal);
+         put_results(results, link);
+      }
+   } catch (const std::exception& e) {
+      put_message(link, "TSILErrorMessage", e.what());
+      MLPutSymbol(link, "$Failed");
+   } catch (...) {
+      put_message(link, "TSILErrorMessage", "An unknown exception has been thrown.");
+      MLPutSymbol(link, "$Failed");
+   }
+
+   return LIBRARY_NO_ERROR;
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILSetNumberOfThreads(
+   WolframLibraryData /* libData */, mint Argc, MArgument* Args, MArgument Res)
+{
+   if (Argc != 1) {
+      return LIBRARY_FUNCTION_ERROR;
+   }
+
+   const mint n_threads = MArgument_getInteger(Args[0]);
+
+   if (n_threads < 0) {
+      return LIBRARY_FUNCTION_ERROR;
+   }
+
+   set_number_of_threads(static_cast<std::size_t>(n_threads));
+
+   MArgument_setInteger(Res, static_cast<mint>(get_number_of_threads()));
+
+   return LIBRARY_NO_ERROR;
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILGetNumberOfThreads(
+   WolframLibraryData /* libData */, mint Argc, MArgument* /* Args */, MArgument Res)
+{
+   if (Argc != 0) {
+      return LIBRARY_FUNCTION_ERROR;
+   }
+
+   MArgument_setInteger(Res, static_cast<mint>(get_number_of_threads()));
+
+   return LIBRARY_NO_ERROR;
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILCacheStatistics(
+   WolframLibraryData libData, mint Argc, MArgument* /* Args */, MArgument Res)
+{
+   if (Argc != 0) {
+      return LIBRARY_FUNCTION_ERROR;
+   }
+
+   const auto stats = get_cache_statistics();
+   const mint dims[1] = { 6 };
+   MTensor res;
+
+   if (libData->MTensor_new(MType_Integer, 1, dims, &res) != LIBRARY_NO_ERROR) {
+      return LIBRARY_MEMORY_ERROR;
+   }
+
+   mint* data = libData->MTensor_getIntegerData(res);
+   data[0] = static_cast<mint>(stats.hits);
+   data[1] = static_cast<mint>(stats.misses);
+   data[2] = static_cast<mint>(stats.entries);
+   data[3] = static_cast<mint>(stats.bytes);
+   data[4] = static_cast<mint>(stats.max_bytes);
+   data[5] = static_cast<mint>(stats.rescaled_hits);
+
+   MArgument_setMTensor(Res, res);
+
+   return LIBRARY_NO_ERROR;
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILSetCacheSize(
+   WolframLibraryData /* libData */, mint Argc, MArgument* Args, MArgument Res)
+{
+   if (Argc != 1) {
+      return LIBRARY_FUNCTION_ERROR;
+   }
+
+   const mint max_bytes = MArgument_getInteger(Args[0]);
+
+   if (max_bytes < 0) {
+      return LIBRARY_FUNCTION_ERROR;
+   }
+
+   set_cache_size(static_cast<std::size_t>(max_bytes));
+
+   MArgument_setInteger(Res, max_bytes);
+
+   return LIBRARY_NO_ERROR;
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILSetCacheNormalization(
+   WolframLibraryData /* libData */, mint Argc, MArgument* Args, MArgument Res)
+{
+   if (Argc != 1) {
+      return LIBRARY_FUNCTION_ERROR;
+   }
+
+   set_cache_normalization(MArgument_getBoolean(Args[0]) != 0);
+
+   MArgument_setBoolean(Res, get_cache_normalization() ? True : False);
+
+   return LIBRARY_NO_ERROR;
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILClearCache(
+   WolframLibraryData /* libData */, mint Argc, MArgument* /* Args */, MArgument /* Res */)
+{
+   if (Argc != 0) {
+      return LIBRARY_FUNCTION_ERROR;
+   }
+
+   clear_cache();
+
+   return LIBRARY_NO_ERROR;
+}
+
+/******************************************************************/
+
+/// arguments: {file name} (empty to close the store) and the capacity in bytes
+DLLEXPORT int TSILSetResultStore(
+   WolframLibraryData /* libData */, MLINK link)
+{
+   if (!check_number_of_args(link, 2, "TSILSetResultStore")) {
+      return argument_error(link);
+   }
+
+   try {
+      const auto path = read_strings(link);
+      const auto max_bytes = MLRead<double>(link);
+
+      if (MLNewPacket(link) == 0) {
+         throw std::runtime_error("Cannot create new packet!");
+      }
+
+      if (path.size() != 1 || max_bytes < 0) {
+         throw std::runtime_error("TSILSetResultStore expects a file name and a capacity in bytes.");
+      }
+
+      set_result_store(path.front(), static_cast<std::size_t>(max_bytes));
+
+      MLPutSymbol(link, "Null");
+   } catch (const std::exception& e) {
+      put_message(link, "TSILErrorMessage", e.what());
+      MLPutSymbol(link, "$Failed");
+   } catch (...) {
+      put_message(link, "TSILErrorMessage", "An unknown exception has been thrown.");
+      MLPutSymbol(link, "$Failed");
+   }
+
+   return LIBRARY_NO_ERROR;
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILResultStoreStatistics(
+   WolframLibraryData libData, mint Argc, MArgument* /* Args */, MArgument Res)
+{
+   if (Argc != 0) {
+      return LIBRARY_FUNCTION_ERROR;
+   }
+
+   Store_statistics stats;
+
+   try {
+      stats = get_store_statistics();
+   } catch (const std::exception& e) {
+      put_message(libData, "TSILErrorMessage", e.what());
+      return LIBRARY_FUNCTION_ERROR;
+   }
+
+   const mint dims[1] = { 6 };
+   MTensor res;
+
+   if (libData->MTensor_new(MType_Integer, 1, dims, &res) != LIBRARY_NO_ERROR) {
+      return LIBRARY_MEMORY_ERROR;
+   }
+
+   mint* data = libData->MTensor_getIntegerData(res);
+   data[0] = static_cast<mint>(stats.hits);
+   data[1] = static_cast<mint>(stats.misses);
+   data[2] = static_cast<mint>(stats.rejected);
+   data[3] = static_cast<mint>(stats.entries);
+   data[4] = static_cast<mint>(stats.bytes);
+   data[5] = static_cast<mint>(stats.max_bytes);
+
+   MArgument_setMTensor(Res, res);
+
+   return LIBRARY_NO_ERROR;
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILFunctionStatistics(
+   WolframLibraryData libData, mint Argc, MArgument* /* Args */, MArgument Res)
+{
+   if (Argc != 0) {
+      return LIBRARY_FUNCTION_ERROR;
+   }
+
+   const auto stats = get_function_statistics();
+   const mint dims[2] = { NUMBER_OF_FUNCTIONS, 6 };
+   MTensor res;
+
+   if (libData->MTensor_new(MType_Real, 2, dims, &res) != LIBRARY_NO_ERROR) {
+      return LIBRARY_MEMORY_ERROR;
+   }
+
+   // rows ordered as the Function enum
+   mreal* data = libData->MTensor_getRealData(res);
+
+   for (const auto& st: stats) {
+      *data++ = static_cast<mreal>(st.calls);
+      *data++ = static_cast<mreal>(st.cache_hits);
+      *data++ = static_cast<mreal>(st.analytic);
+      *data++ = static_cast<mreal>(st.ode);
+      *data++ = st.analytic_seconds;
+      *data++ = st.ode_seconds;
+   }
+
+   MArgument_setMTensor(Res, res);
+
+   return LIBRARY_NO_ERROR;
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILResetStatistics(
+   WolframLibraryData /* libData */, mint Argc, MArgument* /* Args */, MArgument /* Res */)
+{
+   if (Argc != 0) {
+      return LIBRARY_FUNCTION_ERROR;
+   }
+
+   reset_function_statistics();
+
+   return LIBRARY_NO_ERROR;
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILTracing(
+   WolframLibraryData /* libData */, mint Argc, MArgument* /* Args */, MArgument Res)
+{
+   if (Argc != 0) {
+      return LIBRARY_FUNCTION_ERROR;
+   }
+
+   // the string must stay valid until the kernel has copied it
+   static std::string json;
+   json = tracing_json();
+
+   MArgument_setUTF8String(Res, const_cast<char*>(json.c_str()));
+
+   return LIBRARY_NO_ERROR;
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILResetTracing(
+   WolframLibraryData /* libData */, mint Argc, MArgument* /* Args */, MArgument /* Res */)
+{
+   if (Argc != 0) {
+      return LIBRARY_FUNCTION_ERROR;
+   }
+
+   reset_tracing();
+
+   return LIBRARY_NO_ERROR;
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILA(WolframLibraryData /* libData */, MLINK link)
+{
+   return calculate_linkobject(Function::A, "TSILA", link);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILAp(WolframLibraryData /* libData */, MLINK link)
+{
+   return calculate_linkobject(Function::Ap, "TSILAp", link);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILAeps(WolframLibraryData /* libData */, MLINK link)
+{
+   return calculate_linkobject(Function::Aeps, "TSILAeps", link);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILB(WolframLibraryData /* libData */, MLINK link)
+{
+   return calculate_linkobject(Function::B, "TSILB", link);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILBp(WolframLibraryData /* libData */, MLINK link)
+{
+   return calculate_linkobject(Function::Bp, "TSILBp", link);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILdBds(WolframLibraryData /* libData */, MLINK link)
+{
+   return calculate_linkobject(Function::dBds, "TSILdBds", link);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILBeps(WolframLibraryData /* libData */, MLINK link)
+{
+   return calculate_linkobject(Function::Beps, "TSILBeps", link);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILI(WolframLibraryData /* libData */, MLINK link)
+{
+   return calculate_linkobject(Function::I, "TSILI", link);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILIp(WolframLibraryData /* libData */, MLINK link)
+{
+   return calculate_linkobject(Function::Ip, "TSILIp", link);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILIp2(WolframLibraryData /* libData */, MLINK link)
+{
+   return calculate_linkobject(Function::Ip2, "TSILIp2", link);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILIpp(WolframLibraryData /* libData */, MLINK link)
+{
+   return calculate_linkobject(Function::Ipp, "TSILIpp", link);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILIp3(WolframLibraryData /* libData */, MLINK link)
+{
+   return calculate_linkobject(Function::Ip3, "TSILIp3", link);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILM(WolframLibraryData /* libData */, MLINK link)
+{
+   return calculate_linkobject(Function::M, "TSILM", link);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILS(WolframLibraryData /* libData */, MLINK link)
+{
+   return calculate_linkobject(Function::S, "TSILS", link);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILT(WolframLibraryData /* libData */, MLINK link)
+{
+   return calculate_linkobject(Function::T, "TSILT", link);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILTbar(WolframLibraryData /* libData */, MLINK link)
+{
+   return calculate_linkobject(Function::Tbar, "TSILTbar", link);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILU(WolframLibraryData /* libData */, MLINK link)
+{
+   return calculate_linkobject(Function::U, "TSILU", link);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILV(WolframLibraryData /* libData */, MLINK link)
+{
+   return calculate_linkobject(Function::V, "TSILV", link);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILANative(
+   WolframLibraryData libData, mint Argc, MArgument* Args, MArgument Res)
+{
+   return calculate_native(Function::A, libData, Argc, Args, Res);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILApNative(
+   WolframLibraryData libData, mint Argc, MArgument* Args, MArgument Res)
+{
+   return calculate_native(Function::Ap, libData, Argc, Args, Res);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILAepsNative(
+   WolframLibraryData libData, mint Argc, MArgument* Args, MArgument Res)
+{
+   return calculate_native(Function::Aeps, libData, Argc, Args, Res);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILBNative(
+   WolframLibraryData libData, mint Argc, MArgument* Args, MArgument Res)
+{
+   return calculate_native(Function::B, libData, Argc, Args, Res);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILBpNative(
+   WolframLibraryData libData, mint Argc, MArgument* Args, MArgument Res)
+{
+   return calculate_native(Function::Bp, libData, Argc, Args, Res);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILdBdsNative(
+   WolframLibraryData libData, mint Argc, MArgument* Args, MArgument Res)
+{
+   return calculate_native(Function::dBds, libData, Argc, Args, Res);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILBepsNative(
+   WolframLibraryData libData, mint Argc, MArgument* Args, MArgument Res)
+{
+   return calculate_native(Function::Beps, libData, Argc, Args, Res);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILINative(
+   WolframLibraryData libData, mint Argc, MArgument* Args, MArgument Res)
+{
+   return calculate_native(Function::I, libData, Argc, Args, Res);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILIpNative(
+   WolframLibraryData libData, mint Argc, MArgument* Args, MArgument Res)
+{
+   return calculate_native(Function::Ip, libData, Argc, Args, Res);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILIp2Native(
+   WolframLibraryData libData, mint Argc, MArgument* Args, MArgument Res)
+{
+   return calculate_native(Function::Ip2, libData, Argc, Args, Res);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILIppNative(
+   WolframLibraryData libData, mint Argc, MArgument* Args, MArgument Res)
+{
+   return calculate_native(Function::Ipp, libData, Argc, Args, Res);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILIp3Native(
+   WolframLibraryData libData, mint Argc, MArgument* Args, MArgument Res)
+{
+   return calculate_native(Function::Ip3, libData, Argc, Args, Res);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILMNative(
+   WolframLibraryData libData, mint Argc, MArgument* Args, MArgument Res)
+{
+   return calculate_native(Function::M, libData, Argc, Args, Res);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILSNative(
+   WolframLibraryData libData, mint Argc, MArgument* Args, MArgument Res)
+{
+   return calculate_native(Function::S, libData, Argc, Args, Res);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILTNative(
+   WolframLibraryData libData, mint Argc, MArgument* Args, MArgument Res)
+{
+   return calculate_native(Function::T, libData, Argc, Args, Res);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILTbarNative(
+   WolframLibraryData libData, mint Argc, MArgument* Args, MArgument Res)
+{
+   return calculate_native(Function::Tbar, libData, Argc, Args, Res);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILUNative(
+   WolframLibraryData libData, mint Argc, MArgument* Args, MArgument Res)
+{
+   return calculate_native(Function::U, libData, Argc, Args, Res);
+}
+
+/******************************************************************/
+
+DLLEXPORT int TSILVNative(
+   WolframLibraryData libData, mint Argc, MArgument* Args, MArgument Res)
+{
+   return calculate_native(Function::V, libData, Argc, Args, Res);
+}
+
+/******************************************************************/
+
+DLLEXPORT mint WolframLibrary_getVersion()
+{
+   return WolframLibraryVersion;
+}
+
+/******************************************************************/
+
+DLLEXPORT int WolframLibrary_initialize(WolframLibraryData libData)
+{
+   if (libData->registerLibraryExpressionManager(SESSION_MANAGER, manage_session) != 0) {
+      return LIBRARY_FUNCTION_ERROR;
+   }
+
+   return LIBRARY_NO_ERROR;
+}
+
+/******************************************************************/
+
+DLLEXPORT void WolframLibrary_uninitialize(WolframLibraryData libData)
+{
+   libData->unregisterLibraryExpressionManager(SESSION_MANAGER);
+
+   disconnect_from_server();
+
+   std::lock_guard<std::mutex> lock(sessions_mutex);
+   sessions.clear();
 }
 
 } // extern "C"
@@ -0,0 +1,310 @@
+// ====================================================================
+// This file is part of tsil-mma.
+//
+// tsil-mma is licenced under the GNU General Public License (GNU GPL)
+// version 3.
+// ====================================================================
+
+#include "protocol.h"
+#include "tsil_mma.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace tsil_mma {
+
+namespace {
+
+std::runtime_error system_error(const std::string& what)
+{
+   return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+sockaddr_un make_address(const std::string& path)
+{
+   sockaddr_un addr{};
+   addr.sun_family = AF_UNIX;
+
+   if (path.size() >= sizeof(addr.sun_path)) {
+      throw std::runtime_error("Socket path " + path + " is too long.");
+   }
+
+   std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+   return addr;
+}
+
+/// maximum length of an error message
+constexpr std::uint64_t MAX_ERROR_LENGTH = 1 << 16;
+
+/// maximum length of a Diagnostics message
+constexpr std::uint64_t MAX_DIAGNOSTICS_LENGTH =
+   MAX_POINTS_PER_MESSAGE*(2*sizeof(std::uint64_t) + MAX_DIAGNOSTICS_PER_POINT);
+
+std::runtime_error invalid_message()
+{
+   return std::runtime_error("Invalid message from tsil-mma-server.");
+}
+
+void check_header(const Message_header& header)
+{
+   if (header.magic != PROTOCOL_MAGIC) {
+      throw invalid_message();
+   }
+}
+
+/// reads the data of a Diagnostics message of a request of n_points
+void read_diagnostics(int fd, std::uint64_t size, std::size_t n_points,
+                      std::vector<std::string>& messages)
+{
+   if (size > MAX_DIAGNOSTICS_LENGTH) {
+      throw invalid_message();
+   }
+
+   std::string data(size, '\0');
+   read_exact(fd, &data[0], data.size());
+
+   std::size_t pos = 0;
+
+   while (pos < data.size()) {
+      std::uint64_t index = 0, length = 0;
+
+      if (data.size() - pos < sizeof(index) + sizeof(length)) {
+         throw invalid_message();
+      }
+
+      std::memcpy(&index, &data[pos], sizeof(index));
+      std::memcpy(&length, &data[pos + sizeof(index)], sizeof(length));
+      pos += sizeof(index) + sizeof(length);
+
+      if (index >= n_points || length > data.size() - pos) {
+         throw invalid_message();
+      }
+
+      messages[index].assign(data, pos, length);
+      pos += length;
+   }
+}
+
+/// sends one request of at most MAX_POINTS_PER_MESSAGE points
+void evaluate_request(int fd, const double* points, std::size_t n_points,
+                      double* results, std::vector<std::string>& messages)
+{
+   write_message(fd, Message_type::Evaluate_batch, n_points, points,
+                 n_points*NUMBER_OF_PARAMETERS*sizeof(double));
+
+   Message_header header;
+
+   if (!read_header(fd, header)) {
+      throw std::runtime_error("Connection closed by tsil-mma-server.");
+   }
+
+   check_header(header);
+
+   if (header.type == static_cast<std::uint32_t>(Message_type::Diagnostics)) {
+      read_diagnostics(fd, header.size, n_points, messages);
+
+      if (!read_header(fd, header)) {
+         throw std::runtime_error("Connection closed by tsil-mma-server.");
+      }
+
+      check_header(header);
+   }
+
+   if (header.type == static_cast<std::uint32_t>(Message_type::Error) && header.size <= MAX_ERROR_LENGTH) {
+      std::string message(header.size, '\0');
+      read_exact(fd, &message[0], message.size());
+      throw Server_error(message);
+   }
+
+   if (header.type != static_cast<std::uint32_t>(Message_type::Results) || header.size != n_points) {
+      throw invalid_message();
+   }
+
+   read_exact(fd, results, n_points*NUMBER_OF_RESULTS*2*sizeof(double));
+}
+
+} // anonymous namespace
+
+/******************************************************************/
+
+std::string default_socket_path()
+{
+   if (const char* path = std::getenv("TSIL_MMA_SOCKET")) {
+      return path;
+   }
+
+   return "/tmp/tsil-mma-" + std::to_string(getuid()) + ".sock";
+}
+
+int connect_to_server(const std::string& path)
+{
+   const auto addr = make_address(path);
+   const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+   if (fd < 0) {
+      throw system_error("Cannot create socket");
+   }
+
+   if (connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+      const auto error = system_error("Cannot connect to tsil-mma-server at " + path);
+      close(fd);
+      throw error;
+   }
+
+   return fd;
+}
+
+int listen_on_socket(const std::string& path)
+{
+   const auto addr = make_address(path);
+   const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+   if (fd < 0) {
+      throw system_error("Cannot create socket");
+   }
+
+   // a socket that refuses connections is left over from a server
+   // which has been killed
+   const int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+   if (probe >= 0) {
+      if (connect(probe, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0) {
+         close(probe);
+         close(fd);
+         throw std::runtime_error("Another server is listening on " + path + ".");
+      }
+      close(probe);
+   }
+
+   unlink(path.c_str());
+
+   if (bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 ||
+       listen(fd, SOMAXCONN) != 0) {
+      const auto error = system_error("Cannot listen on " + path);
+      close(fd);
+      throw error;
+   }
+
+   return fd;
+}
+
+/******************************************************************/
+
+void read_exact(int fd, void* data, std::size_t bytes)
+{
+   auto* p = static_cast<char*>(data);
+
+   while (bytes > 0) {
+      const ssize_t n = read(fd, p, bytes);
+      if (n < 0 && errno == EINTR) {
+         continue;
+      }
+      if (n <= 0) {
+         throw n == 0 ? std::runtime_error("Connection closed by peer.")
+                      : system_error("Cannot read from socket");
+      }
+      p += n;
+      bytes -= static_cast<std::size_t>(n);
+   }
+}
+
+bool read_header(int fd, Message_header& header)
+{
+   ssize_t n = 0;
+
+   do {
+      n = recv(fd, &header, sizeof(header), MSG_PEEK);
+   } while (n < 0 && errno == EINTR);
+
+   if (n == 0) {
+      return false;
+   }
+
+   read_exact(fd, &header, sizeof(header));
+
+   return true;
+}
+
+void write_message(int fd, Message_type type, std::uint64_t size, const void* data, std::size_t bytes)
+{
+   Message_header header;
+   header.magic = PROTOCOL_MAGIC;
+   header.type = static_cast<std::uint32_t>(type);
+   header.size = size;
+
+   const auto write_all = [fd] (const char* p, std::size_t n) {
+      while (n > 0) {
+         const ssize_t k = send(fd, p, n, MSG_NOSIGNAL);
+         if (k < 0 && errno == EINTR) {
+            continue;
+         }
+         if (k < 0) {
+            throw system_error("Cannot write to socket");
+         }
+         p += k;
+         n -= static_cast<std::size_t>(k);
+      }
+   };
+
+   write_all(reinterpret_cast<const char*>(&header), sizeof(header));
+   write_all(static_cast<const char*>(data), bytes);
+}
+
+/******************************************************************/
+
+void write_diagnostics(int fd, const std::vector<std::string>& messages)
+{
+   std::string data;
+
+   for (std::size_t i = 0; i < messages.size(); i++) {
+      if (messages[i].empty()) {
+         continue;
+      }
+
+      const std::uint64_t index = i;
+      const std::uint64_t length = std::min<std::uint64_t>(messages[i].size(), MAX_DIAGNOSTICS_PER_POINT);
+
+      data.append(reinterpret_cast<const char*>(&index), sizeof(index));
+      data.append(reinterpret_cast<const char*>(&length), sizeof(length));
+      data.append(messages[i], 0, length);
+   }
+
+   if (!data.empty()) {
+      write_message(fd, Message_type::Diagnostics, data.size(), data.data(), data.size());
+   }
+}
+
+std::vector<double> evaluate_remote(int fd, const double* points, std::size_t n_points,
+                                    std::vector<std::string>* messages)
+{
+   std::vector<double> results(n_points*NUMBER_OF_RESULTS*2);
+   std::vector<std::string> request_messages;
+
+   if (messages) {
+      messages->assign(n_points, {});
+   }
+
+   for (std::size_t first = 0; first < n_points; first += MAX_POINTS_PER_MESSAGE) {
+      const std::size_t n = std::min<std::size_t>(MAX_POINTS_PER_MESSAGE, n_points - first);
+
+      request_messages.assign(n, {});
+      evaluate_request(fd, points + first*NUMBER_OF_PARAMETERS, n,
+                       results.data() + first*NUMBER_OF_RESULTS*2, request_messages);
+
+      if (messages) {
+         std::move(request_messages.begin(), request_messages.end(), messages->begin() + first);
+      }
+   }
+
+   return results;
+}
+
+} // namespace tsil_mma
@@ -0,0 +1,95 @@
+// ====================================================================
+// This file is part of tsil-mma.
+//
+// tsil-mma is licenced under the GNU General Public License (GNU GPL)
+// version 3.
+// ====================================================================
+
+#ifndef TSIL_MMA_PROTOCOL_H
+#define TSIL_MMA_PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * Binary protocol of tsil-mma-server on a Unix domain socket.  As
+ * client and server run on the same node, all numbers are sent in the
+ * native byte order.  Each message starts with a Message_header:
+ *
+ *   Evaluate_batch: size = N, followed by N x 8 doubles
+ *                   {x, y, z, u, v, Re(s), Im(s), qq}
+ *   Results:        size = N, followed by N x 32 x 2 doubles
+ *                   (real and imaginary parts, ordered as result_names())
+ *   Error:          size = length of the following message
+ *   Diagnostics:    size = length of the following data, which contains
+ *                   for each point with diagnostic output its index in
+ *                   the request and the length of the output (both
+ *                   uint64), followed by the output
+ *
+ * A client sends Evaluate_batch requests and receives for each of them
+ * an optional Diagnostics message followed by one Results or Error
+ * message.
+ */
+namespace tsil_mma {
+
+enum class Message_type : std::uint32_t { Evaluate_batch = 1, Results = 2, Error = 3, Diagnostics = 4 };
+
+struct Message_header {
+   std::uint32_t magic{0};
+   std::uint32_t type{0};
+   std::uint64_t size{0};
+};
+
+constexpr std::uint32_t PROTOCOL_MAGIC = 0x4c495354; // "TSIL"
+
+/// maximum number of points of one request (32 MiB of results)
+constexpr std::uint64_t MAX_POINTS_PER_MESSAGE = std::uint64_t(1) << 16;
+
+/// maximum length of the diagnostic output of one point
+constexpr std::uint64_t MAX_DIAGNOSTICS_PER_POINT = 1024;
+
+/// error reported by the server, the connection remains usable
+struct Server_error : std::runtime_error {
+   using std::runtime_error::runtime_error;
+};
+
+/// $TSIL_MMA_SOCKET or /tmp/tsil-mma-<uid>.sock
+std::string default_socket_path();
+
+/// connects to the server at the given socket
+int connect_to_server(const std::string& path);
+
+/// creates the socket of the server, replacing a stale one
+int listen_on_socket(const std::string& path);
+
+/// reads a message header, returns false if the peer has closed the connection
+bool read_header(int fd, Message_header&);
+
+void read_exact(int fd, void* data, std::size_t bytes);
+
+void write_message(int fd, Message_type, std::uint64_t size, const void* data, std::size_t bytes);
+
+/**
+ * Writes a Diagnostics message with the non-empty messages[i] of the
+ * points i of a request, each truncated to MAX_DIAGNOSTICS_PER_POINT.
+ * Nothing is written if all messages are empty.
+ */
+void write_diagnostics(int fd, const std::vector<std::string>& messages);
+
+/**
+ * Sends N points (N x 8 doubles) to the server and returns the
+ * results (N x 64 doubles).  More than MAX_POINTS_PER_MESSAGE points
+ * are sent in several requests.  If messages is not null, the
+ * diagnostic output of point i is stored in (*messages)[i].  An Error
+ * message is thrown as Server_error, all other exceptions leave the
+ * connection in an undefined state.
+ */
+std::vector<double> evaluate_remote(int fd, const double* points, std::size_t n_points,
+                                    std::vector<std::string>* messages = nullptr);
+
+} // namespace tsil_mma
+
+#endif
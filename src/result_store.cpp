@@ -0,0 +1,607 @@
+// ====================================================================
+// This file is part of tsil-mma.
+//
+// tsil-mma is licenced under the GNU General Public License (GNU GPL)
+// version 3.
+// ====================================================================
+
+#include "result_store.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace tsil_mma {
+
+namespace {
+
+constexpr char MAGIC[8] = { 'T', 'S', 'I', 'L', 'M', 'M', 'A', 'S' };
+
+constexpr std::uint32_t VERSION = 1;
+
+/// size of the file header, the entries start behind it
+constexpr std::uint64_t HEADER_SIZE = 4096;
+
+/// the file is grown in steps of at least this size
+constexpr std::uint64_t GROWTH = 1024*1024;
+
+/// minimum capacity of a file
+constexpr std::uint64_t MIN_CAPACITY = HEADER_SIZE + GROWTH;
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+              "the result store needs lock-free atomics in shared memory");
+static_assert(std::numeric_limits<TSIL_REAL>::digits <= 64,
+              "the mantissa of TSIL_REAL must fit into 64 bits");
+
+struct Header {
+   char magic[8];
+   std::uint32_t version;
+   std::uint32_t real_size;   ///< sizeof(TSIL_REAL)
+   std::uint32_t real_digits; ///< mantissa digits of TSIL_REAL
+   std::uint32_t reserved;
+   std::uint64_t capacity;    ///< maximum size of the file
+   std::atomic<std::uint64_t> end;      ///< end of the published entries
+   std::atomic<std::uint32_t> obsolete; ///< set when the file has been replaced
+};
+
+static_assert(sizeof(Header) <= HEADER_SIZE, "header too large");
+
+/// entry, followed by the origin and the values as TSIL_REAL
+struct Entry_header {
+   std::uint64_t hash;
+   std::uint32_t size;     ///< bytes of the entry including this header
+   std::uint32_t n_values;
+   Result_store::Key key;
+};
+
+std::uint64_t entry_size(std::size_t n_values)
+{
+   const std::uint64_t size = sizeof(Entry_header) + (2 + 2*n_values)*sizeof(TSIL_REAL);
+   return (size + 7) & ~std::uint64_t(7);
+}
+
+std::uint64_t hash_key(const Result_store::Key& key)
+{
+   std::uint64_t h = 0xcbf29ce484222325ULL;
+
+   for (const auto w: key) {
+      h = (h ^ w)*0x100000001b3ULL;
+      h ^= h >> 29;
+   }
+
+   return h;
+}
+
+std::runtime_error system_error(const std::string& what)
+{
+   return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+/// holds an exclusive flock() on a file
+class File_lock {
+public:
+   explicit File_lock(int fd_) : fd(fd_)
+   {
+      while (flock(fd, LOCK_EX) != 0) {
+         if (errno != EINTR) {
+            throw system_error("Cannot lock result store");
+         }
+      }
+   }
+   ~File_lock() { flock(fd, LOCK_UN); }
+
+   File_lock(const File_lock&) = delete;
+   File_lock& operator=(const File_lock&) = delete;
+
+private:
+   int fd{-1};
+};
+
+unsigned char* map_file(int fd, std::size_t size, const std::string& path)
+{
+   void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+   if (p == MAP_FAILED) {
+      throw system_error("Cannot map result store " + path);
+   }
+
+   return static_cast<unsigned char*>(p);
+}
+
+std::uint64_t file_size(int fd, const std::string& path)
+{
+   struct stat st;
+
+   if (fstat(fd, &st) != 0) {
+      throw system_error("Cannot read size of result store " + path);
+   }
+
+   return static_cast<std::uint64_t>(st.st_size);
+}
+
+void initialize_header(unsigned char* data, std::uint64_t capacity, std::uint64_t end)
+{
+   auto* header = new (data) Header;
+   std::memcpy(header->magic, MAGIC, sizeof(MAGIC));
+   header->version = VERSION;
+   header->real_size = sizeof(TSIL_REAL);
+   header->real_digits = std::numeric_limits<TSIL_REAL>::digits;
+   header->reserved = 0;
+   header->capacity = capacity;
+   header->end.store(end, std::memory_order_release);
+   header->obsolete.store(0, std::memory_order_release);
+}
+
+void check_header(const Header& header, const std::string& path)
+{
+   if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION) {
+      throw std::runtime_error(path + " is not a tsil-mma result store.");
+   }
+   if (header.real_size != sizeof(TSIL_REAL) ||
+       header.real_digits != static_cast<std::uint32_t>(std::numeric_limits<TSIL_REAL>::digits)) {
+      throw std::runtime_error("The result store " + path + " has been created with"
+                               " a different precision of TSIL_REAL.");
+   }
+}
+
+/// reads the header of an entry and checks that it lies within [offset, end)
+Entry_header read_entry_header(const unsigned char* data, std::uint64_t offset,
+                               std::uint64_t end, const std::string& path)
+{
+   Entry_header eh;
+
+   if (offset + sizeof(Entry_header) > end) {
+      throw std::runtime_error("The result store " + path + " is corrupted.");
+   }
+
+   std::memcpy(&eh, data + offset, sizeof(eh));
+
+   if (eh.size != entry_size(eh.n_values) || offset + eh.size > end) {
+      throw std::runtime_error("The result store " + path + " is corrupted.");
+   }
+
+   return eh;
+}
+
+/// file descriptor and mapping of a store
+struct Mapped_file {
+   int fd{-1};
+   unsigned char* data{nullptr};
+   std::size_t size{0}; ///< size of the mapping
+
+   Mapped_file() = default;
+   Mapped_file(const Mapped_file&) = delete;
+   Mapped_file& operator=(const Mapped_file&) = delete;
+
+   ~Mapped_file()
+   {
+      if (data) {
+         munmap(data, size);
+      }
+      if (fd >= 0) {
+         close(fd);
+      }
+   }
+
+   Header& header() const { return *reinterpret_cast<Header*>(data); }
+};
+
+} // anonymous namespace
+
+/******************************************************************/
+
+struct Result_store::File : Mapped_file {};
+
+/******************************************************************/
+
+Result_store::Result_store(const std::string& path, std::size_t max_bytes)
+   : file_name(path)
+   , requested_bytes(max_bytes)
+{
+   if (max_bytes < MIN_CAPACITY) {
+      throw std::runtime_error("The capacity of the result store must be at least "
+                               + std::to_string(MIN_CAPACITY) + " bytes.");
+   }
+
+   open();
+}
+
+Result_store::~Result_store() = default;
+
+/******************************************************************/
+
+bool Result_store::make_key(int function, const TSIL_REAL* args, std::size_t n_args, Key& key)
+{
+   constexpr int digits = std::numeric_limits<TSIL_REAL>::digits;
+
+   if (n_args > NUMBER_OF_PARAMETERS) {
+      throw std::runtime_error("Bug: too many arguments for result store key.");
+   }
+
+   key.fill(0);
+   key[0] = static_cast<std::uint64_t>(function);
+
+   // exact, padding-free encoding: mantissa, and exponent and sign
+   for (std::size_t i = 0; i < n_args; i++) {
+      const TSIL_REAL a = args[i];
+
+      if (!std::isfinite(a)) {
+         return false;
+      }
+
+      std::uint64_t mantissa = 0, exponent_sign = std::signbit(a) ? 1 : 0;
+
+      if (a != 0) {
+         int exponent = 0;
+         const TSIL_REAL m = std::frexp(std::abs(a), &exponent);
+         mantissa = static_cast<std::uint64_t>(std::ldexp(m, digits));
+         exponent_sign |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(exponent)) << 1;
+      }
+
+      key[1 + 2*i] = mantissa;
+      key[2 + 2*i] = exponent_sign;
+   }
+
+   return true;
+}
+
+/******************************************************************/
+
+bool Result_store::get(const Key& key, std::vector<TSIL_COMPLEXCPP>& values, Origin& origin)
+{
+   std::lock_guard<std::mutex> lock(mutex);
+
+   reopen_if_obsolete();
+   update_index();
+
+   std::uint64_t offset = 0;
+
+   if (!find(key, hash_key(key), offset)) {
+      misses++;
+      return false;
+   }
+
+   hits++;
+
+   Entry_header eh;
+   std::memcpy(&eh, file->data + offset, sizeof(eh));
+
+   const unsigned char* p = file->data + offset + sizeof(Entry_header);
+   std::memcpy(origin.data(), p, sizeof(origin));
+   p += sizeof(origin);
+
+   values.resize(eh.n_values);
+
+   for (auto& v: values) {
+      TSIL_REAL re, im;
+      std::memcpy(&re, p, sizeof(re));
+      std::memcpy(&im, p + sizeof(re), sizeof(im));
+      p += 2*sizeof(TSIL_REAL);
+      v = TSIL_COMPLEXCPP(re, im);
+   }
+
+   return true;
+}
+
+/******************************************************************/
+
+void Result_store::put(const Key& key, const std::vector<TSIL_COMPLEXCPP>& values,
+                       const Origin& origin)
+{
+   std::lock_guard<std::mutex> lock(mutex);
+
+   const std::uint64_t hash = hash_key(key);
+   const std::uint64_t size = entry_size(values.size());
+
+   while (true) {
+      reopen_if_obsolete();
+
+      File_lock file_lock(file->fd);
+
+      // the file may have been replaced while waiting for the lock
+      if (file->header().obsolete.load(std::memory_order_acquire)) {
+         continue;
+      }
+
+      // another process may have stored the key in the meantime
+      update_index();
+
+      std::uint64_t offset = 0;
+
+      if (find(key, hash, offset)) {
+         return;
+      }
+
+      const std::uint64_t end = file->header().end.load(std::memory_order_acquire);
+
+      if (end + size > file->size) {
+         rejected++;
+         return;
+      }
+
+      const std::uint64_t current_size = file_size(file->fd, file_name);
+
+      if (end + size > current_size) {
+         const std::uint64_t new_size =
+            std::min<std::uint64_t>(file->size, std::max(end + size, current_size + GROWTH));
+         if (ftruncate(file->fd, static_cast<off_t>(new_size)) != 0) {
+            throw system_error("Cannot grow result store " + file_name);
+         }
+      }
+
+      Entry_header eh{};
+      eh.hash = hash;
+      eh.size = static_cast<std::uint32_t>(size);
+      eh.n_values = static_cast<std::uint32_t>(values.size());
+      eh.key = key;
+
+      unsigned char* p = file->data + end;
+      std::memcpy(p, &eh, sizeof(eh));
+      p += sizeof(eh);
+      std::memcpy(p, origin.data(), sizeof(origin));
+      p += sizeof(origin);
+
+      for (const auto& v: values) {
+         const TSIL_REAL re = std::real(v), im = std::imag(v);
+         std::memcpy(p, &re, sizeof(re));
+         std::memcpy(p + sizeof(re), &im, sizeof(im));
+         p += 2*sizeof(TSIL_REAL);
+      }
+
+      // publish the entry
+      file->header().end.store(end + size, std::memory_order_release);
+
+      return;
+   }
+}
+
+/******************************************************************/
+
+Store_statistics Result_store::statistics()
+{
+   std::lock_guard<std::mutex> lock(mutex);
+
+   reopen_if_obsolete();
+   update_index();
+
+   return Store_statistics{hits, misses, rejected, index.size(),
+                           static_cast<std::size_t>(indexed_end - HEADER_SIZE),
+                           static_cast<std::size_t>(file->size)};
+}
+
+/******************************************************************/
+
+void Result_store::open()
+{
+   while (true) {
+      auto f = std::make_unique<File>();
+
+      f->fd = ::open(file_name.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+
+      if (f->fd < 0) {
+         throw system_error("Cannot open result store " + file_name);
+      }
+
+      std::uint64_t capacity = 0;
+
+      {
+         File_lock file_lock(f->fd);
+
+         const bool created = file_size(f->fd, file_name) == 0;
+
+         if (created && ftruncate(f->fd, static_cast<off_t>(HEADER_SIZE)) != 0) {
+            throw system_error("Cannot create result store " + file_name);
+         }
+
+         if (file_size(f->fd, file_name) < HEADER_SIZE) {
+            throw std::runtime_error(file_name + " is not a tsil-mma result store.");
+         }
+
+         unsigned char* data = map_file(f->fd, HEADER_SIZE, file_name);
+
+         if (created) {
+            initialize_header(data, requested_bytes, HEADER_SIZE);
+         }
+
+         const auto& header = *reinterpret_cast<const Header*>(data);
+         bool obsolete = false;
+
+         try {
+            check_header(header, file_name);
+            capacity = header.capacity;
+            obsolete = header.obsolete.load(std::memory_order_acquire) != 0;
+         } catch (...) {
+            munmap(data, HEADER_SIZE);
+            throw;
+         }
+
+         munmap(data, HEADER_SIZE);
+
+         // replaced by a compaction after we have opened it
+         if (obsolete) {
+            continue;
+         }
+      }
+
+      // map the whole capacity, the file is grown on demand
+      f->size = capacity;
+      f->data = map_file(f->fd, capacity, file_name);
+
+      file = std::move(f);
+      index.clear();
+      indexed_end = HEADER_SIZE;
+
+      return;
+   }
+}
+
+void Result_store::reopen_if_obsolete()
+{
+   if (file->header().obsolete.load(std::memory_order_acquire)) {
+      file.reset();
+      open();
+   }
+}
+
+/// indexes the entries published since the last call
+void Result_store::update_index()
+{
+   const std::uint64_t end = file->header().end.load(std::memory_order_acquire);
+
+   while (indexed_end < end) {
+      const auto eh = read_entry_header(file->data, indexed_end, end, file_name);
+      index.emplace(eh.hash, indexed_end);
+      indexed_end += eh.size;
+   }
+}
+
+bool Result_store::find(const Key& key, std::uint64_t hash, std::uint64_t& offset) const
+{
+   const auto range = index.equal_range(hash);
+
+   for (auto it = range.first; it != range.second; ++it) {
+      Entry_header eh;
+      std::memcpy(&eh, file->data + it->second, sizeof(eh));
+      if (eh.key == key) {
+         offset = it->second;
+         return true;
+      }
+   }
+
+   return false;
+}
+
+/******************************************************************/
+
+Compaction_result compact_result_store(const std::string& path, std::size_t max_bytes)
+{
+   Mapped_file old;
+   Compaction_result result;
+
+   old.fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+
+   if (old.fd < 0) {
+      throw system_error("Cannot open result store " + path);
+   }
+
+   File_lock file_lock(old.fd);
+
+   old.size = file_size(old.fd, path);
+
+   if (old.size < HEADER_SIZE) {
+      throw std::runtime_error(path + " is not a tsil-mma result store.");
+   }
+
+   old.data = map_file(old.fd, old.size, path);
+   check_header(old.header(), path);
+
+   if (old.header().obsolete.load(std::memory_order_acquire)) {
+      throw std::runtime_error("The result store " + path + " is being compacted.");
+   }
+
+   const std::uint64_t end = old.header().end.load(std::memory_order_acquire);
+   const std::uint64_t capacity = max_bytes != 0 ? max_bytes : old.header().capacity;
+   const std::uint64_t limit = max_bytes != 0 ? max_bytes/2 : capacity;
+
+   if (capacity < MIN_CAPACITY) {
+      throw std::runtime_error("The capacity of the result store must be at least "
+                               + std::to_string(MIN_CAPACITY) + " bytes.");
+   }
+
+   // first entry of each key
+   std::vector<std::uint64_t> unique;
+   std::unordered_multimap<std::uint64_t, std::uint64_t> seen;
+
+   for (std::uint64_t offset = HEADER_SIZE; offset < end;) {
+      const auto eh = read_entry_header(old.data, offset, end, path);
+      const auto range = seen.equal_range(eh.hash);
+      bool duplicate = false;
+
+      for (auto it = range.first; it != range.second && !duplicate; ++it) {
+         Entry_header other;
+         std::memcpy(&other, old.data + it->second, sizeof(other));
+         duplicate = other.key == eh.key;
+      }
+
+      if (!duplicate) {
+         seen.emplace(eh.hash, offset);
+         unique.push_back(offset);
+      }
+
+      result.entries_before++;
+      offset += eh.size;
+   }
+
+   result.bytes_before = end - HEADER_SIZE;
+
+   // keep the newest entries that fit into the limit
+   std::uint64_t new_end = HEADER_SIZE;
+   auto first_kept = unique.size();
+
+   while (first_kept > 0) {
+      Entry_header eh;
+      std::memcpy(&eh, old.data + unique[first_kept - 1], sizeof(eh));
+      if (new_end + eh.size > limit) {
+         break;
+      }
+      new_end += eh.size;
+      first_kept--;
+   }
+
+   const std::string tmp_path = path + ".compact";
+   Mapped_file tmp;
+
+   tmp.fd = ::open(tmp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+   if (tmp.fd < 0) {
+      throw system_error("Cannot create " + tmp_path);
+   }
+
+   if (ftruncate(tmp.fd, static_cast<off_t>(new_end)) != 0) {
+      throw system_error("Cannot create " + tmp_path);
+   }
+
+   tmp.size = new_end;
+   tmp.data = map_file(tmp.fd, tmp.size, tmp_path);
+
+   std::uint64_t offset = HEADER_SIZE;
+
+   for (auto i = first_kept; i < unique.size(); i++) {
+      Entry_header eh;
+      std::memcpy(&eh, old.data + unique[i], sizeof(eh));
+      std::memcpy(tmp.data + offset, old.data + unique[i], eh.size);
+      offset += eh.size;
+   }
+
+   initialize_header(tmp.data, capacity, new_end);
+
+   if (msync(tmp.data, tmp.size, MS_SYNC) != 0 || fsync(tmp.fd) != 0) {
+      throw system_error("Cannot write " + tmp_path);
+   }
+
+   if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+      throw system_error("Cannot replace " + path);
+   }
+
+   // processes which use the old file switch to the new one
+   old.header().obsolete.store(1, std::memory_order_release);
+
+   result.entries_after = unique.size() - first_kept;
+   result.bytes_after = new_end - HEADER_SIZE;
+
+   return result;
+}
+
+} // namespace tsil_mma
@@ -0,0 +1,111 @@
+// ====================================================================
+// This file is part of tsil-mma.
+//
+// tsil-mma is licenced under the GNU General Public License (GNU GPL)
+// version 3.
+// ====================================================================
+
+#ifndef TSIL_MMA_RESULT_STORE_H
+#define TSIL_MMA_RESULT_STORE_H
+
+#include "tsil_mma.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace tsil_mma {
+
+/**
+ * Persistent key-value store of results in a memory-mapped file,
+ * which can be shared by several processes on one node.
+ *
+ * Entries are only appended: a writer locks the file with flock(),
+ * writes the entry behind the last one and then publishes it by
+ * advancing the end offset in the file header.  Readers do not lock
+ * the file, they index the entries up to the published end offset.
+ * If the capacity of the file is reached, no more entries are stored
+ * until the file is compacted with compact_result_store().
+ *
+ * The values are stored in the binary format of TSIL_REAL, so a file
+ * can only be used with the precision it has been created with.
+ */
+class Result_store {
+public:
+   /// function and exact bits of the arguments (see make_key())
+   using Key = std::array<std::uint64_t, 2*NUMBER_OF_PARAMETERS + 1>;
+
+   /// scale and qq of the point the entry has been calculated from
+   using Origin = std::array<TSIL_REAL, 2>;
+
+   /**
+    * Opens the store in the given file.  If the file does not exist,
+    * it is created with a capacity of max_bytes, otherwise the
+    * capacity of the file is used.
+    */
+   Result_store(const std::string& path, std::size_t max_bytes);
+   ~Result_store();
+
+   Result_store(const Result_store&) = delete;
+   Result_store& operator=(const Result_store&) = delete;
+
+   /**
+    * Encodes the function and its arguments.  Returns false if an
+    * argument is not finite, in which case the point is not stored.
+    */
+   static bool make_key(int function, const TSIL_REAL* args, std::size_t n_args, Key& key);
+
+   /// looks up the key and copies the entry to values and origin
+   bool get(const Key&, std::vector<TSIL_COMPLEXCPP>& values, Origin& origin);
+
+   /// appends an entry, unless the key exists or the store is full
+   void put(const Key&, const std::vector<TSIL_COMPLEXCPP>& values, const Origin& origin);
+
+   Store_statistics statistics();
+
+   const std::string& path() const { return file_name; }
+
+private:
+   struct File;
+
+   std::mutex mutex;
+   std::string file_name;
+   std::size_t requested_bytes{0}; ///< capacity of a newly created file
+   std::unique_ptr<File> file;
+   std::unordered_multimap<std::uint64_t, std::uint64_t> index; ///< hash -> offset
+   std::uint64_t indexed_end{0};   ///< end of the indexed entries
+   std::uint64_t hits{0};
+   std::uint64_t misses{0};
+   std::uint64_t rejected{0};
+
+   void open();
+   void reopen_if_obsolete();
+   void update_index();
+   bool find(const Key&, std::uint64_t hash, std::uint64_t& offset) const;
+};
+
+/// statistics of a compaction
+struct Compaction_result {
+   std::size_t entries_before{0};
+   std::size_t entries_after{0};
+   std::size_t bytes_before{0};
+   std::size_t bytes_after{0};
+};
+
+/**
+ * Rewrites the store in the given file without duplicate entries.  If
+ * max_bytes is non-zero, it becomes the new capacity of the file and
+ * the oldest entries are removed until the remaining ones use at most
+ * half of it.  Processes which have opened the store switch to the
+ * new file at their next access.
+ */
+Compaction_result compact_result_store(const std::string& path, std::size_t max_bytes = 0);
+
+} // namespace tsil_mma
+
+#endif
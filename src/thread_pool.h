@@ -0,0 +1,315 @@
+// ====================================================================
+// This file is part of tsil-mma.
+//
+// tsil-mma is licenced under the GNU General Public License (GNU GPL)
+// version 3.
+// ====================================================================
+
+#ifndef TSIL_MMA_THREAD_POOL_H
+#define TSIL_MMA_THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * Pool of worker threads that processes index ranges in parallel.
+ *
+ * Each call of parallel_for() creates a job, whose index range is
+ * split into one contiguous block per worker.  A worker that has
+ * finished its block steals half of the remaining indices of another
+ * worker, so that expensive points (e.g. near thresholds) do not leave
+ * the other workers idle.
+ *
+ * The thread that calls parallel_for() takes part in its job as
+ * worker 0.  Idle pool threads join the oldest job that still has free
+ * worker slots, so concurrent calls (e.g. from a background task and
+ * from the kernel) share the pool instead of waiting for each other.
+ */
+class Thread_pool {
+public:
+   explicit Thread_pool(std::size_t n_workers = default_number_of_workers())
+   {
+      start(n_workers);
+   }
+
+   Thread_pool(const Thread_pool&) = delete;
+   Thread_pool(Thread_pool&&) = delete;
+   Thread_pool& operator=(const Thread_pool&) = delete;
+   Thread_pool& operator=(Thread_pool&&) = delete;
+
+   ~Thread_pool() { stop(); }
+
+   static std::size_t default_number_of_workers()
+   {
+      return std::max(1u, std::thread::hardware_concurrency());
+   }
+
+   /// number of workers, including the calling thread
+   std::size_t size() const { return n_threads.load() + 1; }
+
+   /// changes the number of workers (0 = default), waits for running jobs
+   void resize(std::size_t n_workers)
+   {
+      std::unique_lock<std::shared_timed_mutex> resize_lock(resize_mutex);
+      stop();
+      start(n_workers == 0 ? default_number_of_workers() : n_workers);
+   }
+
+   /**
+    * Calls f(worker, i) for all i in [0, n) and blocks until all calls
+    * have finished.  worker is unique among the threads working on
+    * this call.  If f throws, the remaining indices are skipped and the
+    * first exception is re-thrown.
+    */
+   template <class F>
+   void parallel_for(std::size_t n, F&& f)
+   {
+      parallel_for(n, [] (std::size_t) {}, std::forward<F>(f));
+   }
+
+   /**
+    * Same as parallel_for(n, f), but calls setup(n_workers) first,
+    * where worker < n_workers in all calls of f.  Per-worker data must
+    * be sized in setup, because the number of workers is fixed only
+    * while resize() is excluded.
+    */
+   template <class S, class F>
+   void parallel_for(std::size_t n, S&& setup, F&& f)
+   {
+      if (n == 0) {
+         return;
+      }
+
+      // nested calls from a worker do not take the resize lock, which
+      // is already held by the outer call
+      std::shared_lock<std::shared_timed_mutex> resize_lock(resize_mutex, std::defer_lock);
+      if (!is_worker()) {
+         resize_lock.lock();
+      }
+
+      const std::size_t n_workers = n == 1 ? 1 : size();
+
+      setup(n_workers);
+
+      if (n_workers == 1) {
+         run_serial(n, f);
+         return;
+      }
+
+      Job job(n, n_workers);
+
+      job.run = [&f, &job] (std::size_t worker) {
+         std::size_t i = 0;
+         while (!job.failed.load() && next_index(job.ranges, worker, i)) {
+            try {
+               f(worker, i);
+            } catch (...) {
+               std::lock_guard<std::mutex> lock(job.error_mutex);
+               if (!job.error) {
+                  job.error = std::current_exception();
+               }
+               job.failed.store(true);
+            }
+         }
+      };
+
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         jobs.push_back(&job);
+      }
+      start_cv.notify_all();
+
+      run_as_worker(job, 0);
+
+      {
+         std::unique_lock<std::mutex> lock(mutex);
+         remove_job(&job);
+         done_cv.wait(lock, [&job] { return job.active == 0; });
+      }
+
+      if (job.error) {
+         std::rethrow_exception(job.error);
+      }
+   }
+
+private:
+   /// remaining indices [begin, end) of a worker
+   struct Range {
+      std::mutex mutex;
+      std::size_t begin{0};
+      std::size_t end{0};
+   };
+
+   /// state of one parallel_for() call
+   struct Job {
+      Job(std::size_t n, std::size_t n_workers) : ranges(n_workers)
+      {
+         for (std::size_t w = 0; w < n_workers; w++) {
+            ranges[w].begin = n*w/n_workers;
+            ranges[w].end = n*(w + 1)/n_workers;
+         }
+      }
+
+      std::function<void(std::size_t)> run;
+      std::vector<Range> ranges;
+      std::size_t next_worker{1};  ///< next free worker slot, protected by the pool mutex
+      std::size_t active{0};       ///< pool threads working on the job, protected by the pool mutex
+      std::exception_ptr error;
+      std::mutex error_mutex;
+      std::atomic<bool> failed{false};
+   };
+
+   std::vector<std::thread> threads;
+   std::atomic<std::size_t> n_threads{0};
+   std::shared_timed_mutex resize_mutex; ///< excludes resize() during parallel_for()
+   std::mutex mutex;                ///< protects the fields below
+   std::condition_variable start_cv;
+   std::condition_variable done_cv;
+   std::deque<Job*> jobs;           ///< jobs with free worker slots
+   bool stopping{false};
+
+   static bool& is_worker()
+   {
+      static thread_local bool worker = false;
+      return worker;
+   }
+
+   template <class F>
+   static void run_serial(std::size_t n, F& f)
+   {
+      for (std::size_t i = 0; i < n; i++) {
+         f(0, i);
+      }
+   }
+
+   /// takes the next index of the worker or steals from others
+   static bool next_index(std::vector<Range>& ranges, std::size_t worker, std::size_t& i)
+   {
+      {
+         Range& own = ranges[worker];
+         std::lock_guard<std::mutex> lock(own.mutex);
+         if (own.begin < own.end) {
+            i = own.begin++;
+            return true;
+         }
+      }
+
+      const std::size_t n_workers = ranges.size();
+
+      for (std::size_t k = 1; k < n_workers; k++) {
+         Range& victim = ranges[(worker + k) % n_workers];
+         std::size_t begin = 0, end = 0;
+
+         {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            const std::size_t remaining = victim.end - victim.begin;
+            if (remaining == 0) {
+               continue;
+            }
+            // steal the back half of the victim's range
+            end = victim.end;
+            begin = victim.end - (remaining + 1)/2;
+            victim.end = begin;
+         }
+
+         i = begin;
+
+         if (begin + 1 < end) {
+            Range& own = ranges[worker];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            own.begin = begin + 1;
+            own.end = end;
+         }
+
+         return true;
+      }
+
+      return false;
+   }
+
+   /// removes the job from the queue, the mutex must be locked
+   void remove_job(Job* job)
+   {
+      const auto it = std::find(jobs.begin(), jobs.end(), job);
+      if (it != jobs.end()) {
+         jobs.erase(it);
+      }
+   }
+
+   void run_as_worker(Job& job, std::size_t worker)
+   {
+      const bool was_worker = is_worker();
+      is_worker() = true;
+      job.run(worker);
+      is_worker() = was_worker;
+   }
+
+   void start(std::size_t n_workers)
+   {
+      stopping = false;
+      n_threads = std::max<std::size_t>(n_workers, 1) - 1;
+
+      for (std::size_t t = 0; t < n_threads; t++) {
+         threads.emplace_back([this] { thread_loop(); });
+      }
+   }
+
+   void stop()
+   {
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         stopping = true;
+      }
+      start_cv.notify_all();
+
+      for (auto& t: threads) {
+         t.join();
+      }
+
+      threads.clear();
+   }
+
+   void thread_loop()
+   {
+      while (true) {
+         Job* job = nullptr;
+         std::size_t worker = 0;
+
+         {
+            std::unique_lock<std::mutex> lock(mutex);
+            start_cv.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (stopping) {
+               return;
+            }
+            job = jobs.front();
+            worker = job->next_worker++;
+            if (job->next_worker >= job->ranges.size()) {
+               jobs.pop_front();
+            }
+            job->active++;
+         }
+
+         run_as_worker(*job, worker);
+
+         {
+            std::lock_guard<std::mutex> lock(mutex);
+            // the job has no indices left, so no other thread needs to join
+            remove_job(job);
+            job->active--;
+         }
+         done_cv.notify_all();
+      }
+   }
+};
+
+#endif
@@ -0,0 +1,213 @@
+// ====================================================================
+// This file is part of tsil-mma.
+//
+// tsil-mma is licenced under the GNU General Public License (GNU GPL)
+// version 3.
+// ====================================================================
+
+#ifndef TSIL_MMA_TRACING_H
+#define TSIL_MMA_TRACING_H
+
+#include "config.h"
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#ifdef TSIL_MMA_ENABLE_TRACING
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <sstream>
+#endif
+
+/**
+ * Latency histograms of the LibraryLink entry points, separately for
+ * the phases parse (reading the arguments), compute (calculation) and
+ * marshal (writing the result).
+ *
+ * The histograms are only recorded if tsil-mma is configured with
+ * -DTSIL_MMA_ENABLE_TRACING=ON.  Otherwise Trace_scope is empty and
+ * tracing_json() returns {"enabled": false}.
+ */
+namespace tsil_mma {
+
+enum class Phase : int { Parse, Compute, Marshal };
+
+constexpr int NUMBER_OF_PHASES = 3;
+
+#ifdef TSIL_MMA_ENABLE_TRACING
+
+/**
+ * Histogram with logarithmic buckets: bucket k counts the durations
+ * in [2^k, 2^(k+1)) ns, bucket 0 also the durations below 1 ns.
+ */
+class Histogram {
+public:
+   static constexpr int NUMBER_OF_BUCKETS = 48;
+
+   void add(std::uint64_t ns)
+   {
+      int k = 0;
+      for (auto n = ns; n > 1 && k < NUMBER_OF_BUCKETS - 1; n >>= 1) {
+         k++;
+      }
+      buckets[k]++;
+      min_ns = count == 0 ? ns : std::min(min_ns, ns);
+      max_ns = std::max(max_ns, ns);
+      total_ns += ns;
+      count++;
+   }
+
+   /// {"count": ..., "total_ns": ..., "min_ns": ..., "max_ns": ...,
+   ///  "buckets": [[lower bound in ns, count], ...]}, without empty buckets
+   void write_json(std::ostream& ostr) const
+   {
+      ostr << "{\"count\": " << count << ", \"total_ns\": " << total_ns
+           << ", \"min_ns\": " << min_ns << ", \"max_ns\": " << max_ns
+           << ", \"buckets\": [";
+
+      bool first = true;
+
+      for (int k = 0; k < NUMBER_OF_BUCKETS; k++) {
+         if (buckets[k] == 0) {
+            continue;
+         }
+         ostr << (first ? "" : ", ") << '[' << (k == 0 ? 0 : std::uint64_t(1) << k)
+              << ", " << buckets[k] << ']';
+         first = false;
+      }
+
+      ostr << "]}";
+   }
+
+private:
+   std::array<std::uint64_t, NUMBER_OF_BUCKETS> buckets{};
+   std::uint64_t count{0};
+   std::uint64_t total_ns{0};
+   std::uint64_t min_ns{0};
+   std::uint64_t max_ns{0};
+};
+
+/// histograms of all entry points
+class Tracer {
+public:
+   static Tracer& instance()
+   {
+      static Tracer tracer;
+      return tracer;
+   }
+
+   void record(const char* function, const std::array<std::uint64_t, NUMBER_OF_PHASES>& ns)
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto it = histograms.find(function);
+      if (it == histograms.end()) {
+         it = histograms.emplace(function, std::array<Histogram, NUMBER_OF_PHASES>{}).first;
+      }
+      auto& h = it->second;
+      for (int p = 0; p < NUMBER_OF_PHASES; p++) {
+         h[p].add(ns[p]);
+      }
+   }
+
+   void reset()
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      histograms.clear();
+   }
+
+   std::string json() const
+   {
+      static const char* phase_names[NUMBER_OF_PHASES] = { "parse", "compute", "marshal" };
+
+      std::lock_guard<std::mutex> lock(mutex);
+      std::ostringstream ostr;
+      ostr << "{\"enabled\": true, \"functions\": {";
+
+      bool first = true;
+
+      for (const auto& f: histograms) {
+         ostr << (first ? "" : ", ") << '"' << f.first << "\": {";
+         for (int p = 0; p < NUMBER_OF_PHASES; p++) {
+            ostr << (p == 0 ? "" : ", ") << '"' << phase_names[p] << "\": ";
+            f.second[p].write_json(ostr);
+         }
+         ostr << '}';
+         first = false;
+      }
+
+      ostr << "}}";
+
+      return ostr.str();
+   }
+
+private:
+   mutable std::mutex mutex;
+   std::map<std::string, std::array<Histogram, NUMBER_OF_PHASES>, std::less<>> histograms;
+};
+
+/**
+ * Measures the phases of one call of an entry point.  The parse phase
+ * starts with the construction, each call of phase() ends the current
+ * phase and starts the given one, and the destructor ends the current
+ * phase and records the durations.
+ */
+class Trace_scope {
+public:
+   explicit Trace_scope(const char* function_) : function(function_) {}
+   Trace_scope(const Trace_scope&) = delete;
+   Trace_scope& operator=(const Trace_scope&) = delete;
+
+   ~Trace_scope()
+   {
+      stop();
+      Tracer::instance().record(function, ns);
+   }
+
+   void phase(Phase next)
+   {
+      stop();
+      current = next;
+   }
+
+private:
+   using Clock = std::chrono::steady_clock;
+
+   const char* function{nullptr};
+   Phase current{Phase::Parse};
+   Clock::time_point start{Clock::now()};
+   std::array<std::uint64_t, NUMBER_OF_PHASES> ns{};
+
+   void stop()
+   {
+      const auto now = Clock::now();
+      ns[static_cast<int>(current)] +=
+         std::chrono::duration_cast<std::chrono::nanoseconds>(now - start).count();
+      start = now;
+   }
+};
+
+inline std::string tracing_json() { return Tracer::instance().json(); }
+
+inline void reset_tracing() { Tracer::instance().reset(); }
+
+#else
+
+class Trace_scope {
+public:
+   explicit Trace_scope(const char*) {}
+   void phase(Phase) {}
+};
+
+inline std::string tracing_json() { return "{\"enabled\": false, \"functions\": {}}"; }
+
+inline void reset_tracing() {}
+
+#endif
+
+} // namespace tsil_mma
+
+#endif
@@ -0,0 +1,1706 @@
+// ====================================================================
+// This file is part of tsil-mma.
+//
+// tsil-mma is licenced under the GNU General Public License (GNU GPL)
+// version 3.
+// ====================================================================
+
+#include "tsil_mma.h"
+#include "cache.h"
+#include "result_store.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace tsil_mma {
+
+namespace {
+
+std::unique_ptr<std::ostringstream>& diagnostics_buffer()
+{
+   static thread_local std::unique_ptr<std::ostringstream> buffer;
+   return buffer;
+}
+
+/******************************************************************/
+
+/// thread pool for the evaluation of parameter batches
+Thread_pool& thread_pool()
+{
+   static Thread_pool pool;
+   return pool;
+}
+
+/******************************************************************/
+
+/// number of results read from TSIL_DATA (all except A and I)
+constexpr int NUMBER_OF_DATA_RESULTS = NUMBER_OF_RESULTS - 5 - 2;
+
+/******************************************************************/
+
+/// sets the masses and qq of the parameter point in TSIL_DATA
+void set_parameters(const Parameters& parsvec, TSIL_DATA& data)
+{
+   TSIL_SetParameters_(&data, parsvec[0], parsvec[1], parsvec[2],
+                       parsvec[3], parsvec[4], parsvec[7]);
+}
+
+/**
+ * Returns the parameters at which evaluate_results() calculates the
+ * results: TSIL_Evaluate_ integrates at Re(s), so Im(s) is set to 0.
+ */
+Parameters evaluated_point(const Parameters& parsvec)
+{
+   Parameters point = parsvec;
+   point[6] = 0;
+   return point;
+}
+
+/**
+ * Calculates all results, using the given TSIL_DATA, for which
+ * set_parameters() has been called with the same masses and qq.
+ */
+void evaluate_results(const Parameters& parsvec, TSIL_DATA& data, Results& results)
+{
+   int c = 0; // counter
+
+   const TSIL_REAL x  = parsvec.at(c++);
+   const TSIL_REAL y  = parsvec.at(c++);
+   const TSIL_REAL z  = parsvec.at(c++);
+   const TSIL_REAL u  = parsvec.at(c++);
+   const TSIL_REAL v  = parsvec.at(c++);
+   const TSIL_REAL rs = parsvec.at(c++); // Re(s)
+   [[maybe_unused]] const TSIL_REAL is = parsvec.at(c++); // Im(s) is unused
+   const TSIL_REAL qq = parsvec.at(c++);
+
+   TSIL_Evaluate_(&data, rs);
+
+   const auto& names = result_names();
+   int k = 0;
+
+   results[k++] = TSIL_GetFunction_(&data, "M");
+
+   while (k < NUMBER_OF_DATA_RESULTS) {
+      results[k] = TSIL_GetFunction_(&data, names[k].c_str());
+      k++;
+   }
+
+   results[k++] = TSIL_A_(x, qq);
+   results[k++] = TSIL_A_(y, qq);
+   results[k++] = TSIL_A_(z, qq);
+   results[k++] = TSIL_A_(u, qq);
+   results[k++] = TSIL_A_(v, qq);
+
+   results[k++] = TSIL_I2_(x, y, v, qq);
+   results[k++] = TSIL_I2_(z, u, v, qq);
+}
+
+/******************************************************************/
+
+/// function and arguments, as read from the parameter list
+struct Cache_key {
+   Function function{Function::Evaluate};
+   std::array<TSIL_REAL, NUMBER_OF_PARAMETERS> args{};
+
+   bool operator==(const Cache_key& other) const
+   {
+      return function == other.function && args == other.args;
+   }
+};
+
+struct Cache_key_hash {
+   std::size_t operator()(const Cache_key& key) const
+   {
+      std::size_t h = std::hash<int>()(static_cast<int>(key.function));
+
+      for (const auto a: key.args) {
+         h ^= std::hash<TSIL_REAL>()(a) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+      }
+
+      return h;
+   }
+};
+
+/**
+ * Scale and qq of the point from which a cache entry has been
+ * calculated.  Entries stored with a normalized key have the origin
+ * {scale, qq}, the other ones {1, qq}.
+ */
+using Cache_origin = std::array<TSIL_REAL, 2>;
+
+using Cache_value = std::pair<std::vector<TSIL_COMPLEXCPP>, Cache_origin>;
+
+using Result_cache = LRU_cache<Cache_key, Cache_value, Cache_key_hash>;
+
+/// default memory limit of the result cache in bytes
+constexpr std::size_t DEFAULT_CACHE_SIZE = 64*1024*1024;
+
+Result_cache& result_cache()
+{
+   static Result_cache cache(DEFAULT_CACHE_SIZE);
+   return cache;
+}
+
+std::mutex result_store_mutex;
+
+/// persistent result store (null if closed)
+std::shared_ptr<Result_store>& result_store()
+{
+   static std::shared_ptr<Result_store> store;
+   return store;
+}
+
+std::shared_ptr<Result_store> get_result_store()
+{
+   std::lock_guard<std::mutex> lock(result_store_mutex);
+   return result_store();
+}
+
+/**
+ * Returns false if an argument is not finite.  Such keys are not
+ * cached, because NaN never compares equal, so the entry could
+ * neither be found nor evicted.
+ */
+bool is_cacheable(const Cache_key& key)
+{
+   return std::all_of(key.args.cbegin(), key.args.cend(),
+                      [] (TSIL_REAL a) { return std::isfinite(a); });
+}
+
+/**
+ * Looks up the key in the result cache and then in the persistent
+ * store, where hits are copied into the cache.  On a hit,
+ * consume(value) is called and true is returned.
+ */
+template <class F>
+bool cache_get(const Cache_key& key, F&& consume)
+{
+   if (!is_cacheable(key)) {
+      return false;
+   }
+
+   if (result_cache().get(key, consume)) {
+      return true;
+   }
+
+   const auto store = get_result_store();
+   Result_store::Key store_key;
+
+   if (!store || !Result_store::make_key(static_cast<int>(key.function), key.args.data(),
+                                         key.args.size(), store_key)) {
+      return false;
+   }
+
+   Cache_value value;
+
+   if (!store->get(store_key, value.first, value.second)) {
+      return false;
+   }
+
+   consume(static_cast<const Cache_value&>(value));
+   result_cache().put(key, std::move(value));
+
+   return true;
+}
+
+/// stores the value in the result cache and in the persistent store
+void cache_put(const Cache_key& key, Cache_value value)
+{
+   if (!is_cacheable(key)) {
+      return;
+   }
+
+   const auto store = get_result_store();
+   Result_store::Key store_key;
+
+   if (store && Result_store::make_key(static_cast<int>(key.function), key.args.data(),
+                                       key.args.size(), store_key)) {
+      store->put(store_key, value.first, value.second);
+   }
+
+   result_cache().put(key, std::move(value));
+}
+
+/**
+ * Creates a cache key from the function arguments.  The arguments are
+ * brought into a canonical order using the symmetries of the
+ * function, so that equivalent calls share one cache entry.
+ */
+template <class Args>
+Cache_key make_cache_key(Function function, const Args& args)
+{
+   if (args.size() > NUMBER_OF_PARAMETERS) {
+      throw std::runtime_error("Bug: too many arguments for cache key.");
+   }
+
+   Cache_key key;
+   key.function = function;
+   std::copy(args.begin(), args.end(), key.args.begin());
+
+   auto& a = key.args;
+
+   switch (function) {
+   case Function::B:    // B(x,y) = B(y,x)
+   case Function::dBds:
+   case Function::Beps:
+   case Function::Ipp:  // Ipp(x,y,z) = Ipp(y,x,z)
+      std::sort(a.begin(), a.begin() + 2);
+      break;
+   case Function::I:    // I(x,y,z) and S(x,y,z) are totally symmetric
+   case Function::S:
+      std::sort(a.begin(), a.begin() + 3);
+      break;
+   case Function::Ip:   // Ip(x,y,z) = Ip(x,z,y), ...
+   case Function::Ip2:
+   case Function::Ip3:
+   case Function::T:
+   case Function::Tbar:
+      std::sort(a.begin() + 1, a.begin() + 3);
+      break;
+   case Function::U:    // U(x,y,z,u) = U(x,y,u,z), ...
+   case Function::V:
+      std::sort(a.begin() + 2, a.begin() + 4);
+      break;
+   case Function::M: {
+      // M(x,y,z,u,v) = M(y,x,u,z,v) = M(z,u,x,y,v) = M(u,z,y,x,v)
+      const std::array<std::array<TSIL_REAL, 4>, 4> perms{{
+         {a[0], a[1], a[2], a[3]},
+         {a[1], a[0], a[3], a[2]},
+         {a[2], a[3], a[0], a[1]},
+         {a[3], a[2], a[1], a[0]}
+      }};
+      const auto& min = *std::min_element(perms.begin(), perms.end());
+      std::copy(min.begin(), min.end(), a.begin());
+      break;
+   }
+   default:
+      break;
+   }
+
+   return key;
+}
+
+
+/******************************************************************/
+
+/// names of the functions, indexed by static_cast<int>(Function)
+const std::array<std::string, NUMBER_OF_FUNCTIONS>& function_names()
+{
+   static const std::array<std::string, NUMBER_OF_FUNCTIONS> names{
+      "Evaluate", "A", "Ap", "Aeps", "B", "Bp", "dBds", "Beps", "I", "Ip",
+      "Ip2", "Ipp", "Ip3", "M", "S", "T", "Tbar", "U", "V"
+   };
+   return names;
+}
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(Clock::time_point start)
+{
+   return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+std::mutex& function_statistics_mutex()
+{
+   static std::mutex mutex;
+   return mutex;
+}
+
+std::array<Function_statistics, NUMBER_OF_FUNCTIONS>& function_statistics()
+{
+   static std::array<Function_statistics, NUMBER_OF_FUNCTIONS> stats{};
+   return stats;
+}
+
+/// calls update(stats) with the statistics of the function
+template <class F>
+void update_statistics(Function function, F&& update)
+{
+   std::lock_guard<std::mutex> lock(function_statistics_mutex());
+   update(function_statistics()[static_cast<int>(function)]);
+}
+
+/******************************************************************/
+
+/// whether cache keys are normalized to an overall scale of 1
+std::atomic<bool> normalize_cache_keys{false};
+
+/// number of cache hits on entries calculated at a different scale
+std::atomic<std::uint64_t> rescaled_hits{0};
+
+Integral integral_of_result(const std::string& name, const Parameters& parsvec);
+
+/**
+ * Power d of the homogeneity relation
+ * F(k*masses, k*s, k*qq) = k^d*F(masses, s, qq).
+ */
+int mass_dimension(Function function)
+{
+   switch (function) {
+   case Function::A:
+   case Function::Aeps:
+   case Function::I:
+   case Function::S:
+      return 1;
+   case Function::Bp:
+   case Function::dBds:
+   case Function::Ip2:
+   case Function::Ipp:
+   case Function::M:
+   case Function::V:
+      return -1;
+   case Function::Ip3:
+      return -2;
+   default:
+      break;
+   }
+
+   return 0;
+}
+
+/**
+ * Scale of a normalized cache key: the largest |mass| or |s| among
+ * the first n_masses arguments and s (if s_pos >= 0).  Returns 0 if
+ * the keys are not normalized.
+ */
+template <class Args>
+TSIL_REAL normalization_scale(const Args& args, std::size_t n_masses, int s_pos)
+{
+   if (!normalize_cache_keys) {
+      return 0;
+   }
+
+   TSIL_REAL scale = 0;
+
+   for (std::size_t i = 0; i < n_masses; i++) {
+      scale = std::max(scale, std::abs(args[i]));
+   }
+
+   if (s_pos >= 0) {
+      scale = std::max(scale, std::abs(TSIL_COMPLEXCPP(args[s_pos], args[s_pos + 1])));
+   }
+
+   return std::isfinite(scale) ? scale : 0;
+}
+
+/// divides masses and s by the scale and sets qq (if qq_pos >= 0) to 1
+template <class Args>
+void normalize(Args& args, TSIL_REAL scale, std::size_t n_masses, int s_pos, int qq_pos)
+{
+   for (std::size_t i = 0; i < n_masses; i++) {
+      args[i] /= scale;
+   }
+
+   if (s_pos >= 0) {
+      args[s_pos] /= scale;
+      args[s_pos + 1] /= scale;
+   }
+
+   if (qq_pos >= 0) {
+      args[qq_pos] = 1;
+   }
+}
+
+/// value of the integral at the normalized point from its value at the original point
+TSIL_COMPLEXCPP to_normalized(const Integral& in, TSIL_COMPLEXCPP value, TSIL_REAL scale)
+{
+   return rescale_integral(in, value, scale)*std::pow(scale, -mass_dimension(in.function));
+}
+
+/// value of the integral at the original point from its value at the normalized point
+TSIL_COMPLEXCPP from_normalized(const Integral& normalized, TSIL_COMPLEXCPP value,
+                                TSIL_REAL scale, TSIL_REAL qq)
+{
+   return rescale_integral(normalized, value, qq/scale)*std::pow(scale, mass_dimension(normalized.function));
+}
+
+/// normalized integral with the scale of its cache key
+struct Normalized_integral {
+   Integral integral;
+   TSIL_REAL scale{0}; ///< 0 if not normalized
+};
+
+Normalized_integral normalize(const Integral& in)
+{
+   const auto& a = in.args;
+   const int s_pos = s_position(in.function);
+   const bool has_qq = in.function != Function::M;
+   const std::size_t n_masses = s_pos >= 0 ? s_pos : a.size() - 1;
+
+   Normalized_integral ni{in, normalization_scale(a, n_masses, s_pos)};
+
+   if (ni.scale > 0) {
+      normalize(ni.integral.args, ni.scale, n_masses, s_pos, has_qq ? a.size() - 1 : -1);
+   }
+
+   return ni;
+}
+
+/******************************************************************/
+
+/**
+ * Calculates all results with lookup in the result cache.  If
+ * parameters_set is false, set_parameters() is called before the
+ * evaluation and parameters_set becomes true.
+ */
+void calculate_results_cached(const Parameters& parsvec, TSIL_DATA& data, Results& results,
+                              bool& parameters_set)
+{
+   // the results do not depend on Im(s), so it is dropped from the
+   // cache key and from the rescaling of the results
+   const Parameters point = evaluated_point(parsvec);
+   const TSIL_REAL scale = normalization_scale(point, 5, 5);
+   const Cache_origin origin{scale > 0 ? scale : 1, point[7]};
+
+   Parameters key_pars = point;
+
+   if (scale > 0) {
+      normalize(key_pars, scale, 5, 5, 7);
+   }
+
+   Cache_key key;
+   key.function = Function::Evaluate;
+   std::copy(key_pars.begin(), key_pars.end(), key.args.begin());
+
+   const auto& names = result_names();
+   Cache_origin hit_origin{};
+
+   const auto copy = [&results, &hit_origin] (const Cache_value& v) {
+      std::copy(v.first.begin(), v.first.end(), results.begin());
+      hit_origin = v.second;
+   };
+
+   if (cache_get(key, copy)) {
+      update_statistics(Function::Evaluate, [] (auto& st) { st.calls++; st.cache_hits++; });
+      if (hit_origin != origin) {
+         rescaled_hits++;
+      }
+      if (scale > 0) {
+         for (int k = 0; k < NUMBER_OF_RESULTS; k++) {
+            results[k] = from_normalized(integral_of_result(names[k], key_pars),
+                                         results[k], scale, point[7]);
+         }
+      }
+      return;
+   }
+
+   const auto start = Clock::now();
+
+   if (!parameters_set) {
+      set_parameters(parsvec, data);
+      parameters_set = true;
+   }
+
+   evaluate_results(parsvec, data, results);
+
+   const double seconds = seconds_since(start);
+   update_statistics(Function::Evaluate, [seconds] (auto& st) {
+      st.calls++;
+      st.ode++;
+      st.ode_seconds += seconds;
+   });
+
+   std::vector<TSIL_COMPLEXCPP> values(results.begin(), results.end());
+
+   if (scale > 0) {
+      for (int k = 0; k < NUMBER_OF_RESULTS; k++) {
+         values[k] = to_normalized(integral_of_result(names[k], point), values[k], scale);
+      }
+   }
+
+   cache_put(key, {std::move(values), origin});
+}
+
+/// calculate_results() with lookup in the result cache
+void calculate_results_cached(const Parameters& parsvec, TSIL_DATA& data, Results& results)
+{
+   bool parameters_set = false;
+   calculate_results_cached(parsvec, data, results, parameters_set);
+}
+
+/******************************************************************/
+
+/// number of squared mass arguments of a function from TSIL_DATA
+std::size_t number_of_masses(Function function)
+{
+   return function == Function::M ? 5 : number_of_arguments(function) - 3;
+}
+
+/**
+ * Calculates the integral without solving the differential equations.
+ * Returns false if this is not possible, i.e. if the integral must be
+ * obtained from TSIL_Evaluate_.
+ */
+bool calculate_without_ode(const Integral& integral, TSIL_COMPLEXCPP& result)
+{
+   const auto& a = integral.args;
+
+   switch (integral.function) {
+   case Function::A:    result = TSIL_A_(a[0], a[1]); return true;
+   case Function::Ap:   result = TSIL_Ap_(a[0], a[1]); return true;
+   case Function::Aeps: result = TSIL_Aeps_(a[0], a[1]); return true;
+   case Function::B:    result = TSIL_B_(a[0], a[1], TSIL_COMPLEXCPP(a[2],a[3]), a[4]); return true;
+   case Function::Bp:   result = TSIL_Bp_(a[0], a[1], TSIL_COMPLEXCPP(a[2],a[3]), a[4]); return true;
+   case Function::dBds: result = TSIL_dBds_(a[0], a[1], TSIL_COMPLEXCPP(a[2],a[3]), a[4]); return true;
+   case Function::Beps: result = TSIL_Beps_(a[0], a[1], TSIL_COMPLEXCPP(a[2],a[3]), a[4]); return true;
+   case Function::I:    result = TSIL_I2_(a[0], a[1], a[2], a[3]); return true;
+   case Function::Ip:   result = TSIL_I2p_(a[0], a[1], a[2], a[3]); return true;
+   case Function::Ip2:  result = TSIL_I2p2_(a[0], a[1], a[2], a[3]); return true;
+   case Function::Ipp:  result = TSIL_I2pp_(a[0], a[1], a[2], a[3]); return true;
+   case Function::Ip3:  result = TSIL_I2p3_(a[0], a[1], a[2], a[3]); return true;
+   case Function::M:
+      return TSIL_Manalytic_(a[0], a[1], a[2], a[3], a[4], TSIL_COMPLEXCPP(a[5],a[6]), &result) != 0;
+   case Function::S:
+      return TSIL_Sanalytic_(a[0], a[1], a[2], TSIL_COMPLEXCPP(a[3],a[4]), a[5], &result) != 0;
+   case Function::T:
+      return TSIL_Tanalytic_(a[0], a[1], a[2], TSIL_COMPLEXCPP(a[3],a[4]), a[5], &result) != 0;
+   case Function::Tbar:
+      return TSIL_Tbaranalytic_(a[0], a[1], a[2], TSIL_COMPLEXCPP(a[3],a[4]), a[5], &result) != 0;
+   case Function::U:
+      return TSIL_Uanalytic_(a[0], a[1], a[2], a[3], TSIL_COMPLEXCPP(a[4],a[5]), a[6], &result) != 0;
+   case Function::V:
+      return TSIL_Vanalytic_(a[0], a[1], a[2], a[3], TSIL_COMPLEXCPP(a[4],a[5]), a[6], &result) != 0;
+   default:
+      break;
+   }
+
+   throw std::runtime_error("Bug: cannot calculate function without TSIL_Evaluate.");
+}
+
+/******************************************************************/
+
+/// number of squared masses {x, y, z, u, v} of TSIL_DATA
+constexpr int NUMBER_OF_MASSES = 5;
+
+/**
+ * Position of an integral function in TSIL_DATA: the TSIL name of the
+ * function and the argument that is put into each mass slot {x, y, z,
+ * u, v} (-1 if the slot is not used).
+ */
+struct Placement {
+   std::string name;
+   std::array<int, NUMBER_OF_MASSES> arg_of_slot{};
+};
+
+/**
+ * Returns all placements of the function in TSIL_DATA, including the
+ * argument permutations allowed by the symmetries of the function.
+ * The placements are derived from the TSIL names, e.g. "Tvyz" stands
+ * for T(v,y,z).
+ */
+const std::vector<Placement>& placements(Function function)
+{
+   static const auto all = [] {
+      using Permutations = std::vector<std::vector<int>>;
+
+      const auto symmetries = [] (Function f) -> Permutations {
+         switch (f) {
+         case Function::M: return {{0,1,2,3,4}, {1,0,3,2,4}, {2,3,0,1,4}, {3,2,1,0,4}};
+         case Function::S: return {{0,1,2}, {0,2,1}, {1,0,2}, {1,2,0}, {2,0,1}, {2,1,0}};
+         case Function::T:
+         case Function::Tbar: return {{0,1,2}, {0,2,1}};
+         case Function::U:
+         case Function::V: return {{0,1,2,3}, {0,1,3,2}};
+         default: break;
+         }
+         return {};
+      };
+
+      const auto function_of_prefix = [] (const std::string& prefix) {
+         if (prefix == "TBAR") {
+            return Function::Tbar;
+         }
+         return function_from_name(prefix);
+      };
+
+      const std::string slots = "xyzuv";
+      std::vector<std::vector<Placement>> p(static_cast<int>(Function::V) + 1);
+      const auto& names = result_names();
+
+      for (int k = 0; k < NUMBER_OF_DATA_RESULTS; k++) {
+         const auto& name = names[k];
+         const auto pos = name.find_first_of(slots);
+         const auto f = function_of_prefix(name.substr(0, pos));
+
+         for (const auto& perm: symmetries(f)) {
+            Placement pl;
+            pl.name = f == Function::M ? "M" : name;
+            pl.arg_of_slot.fill(-1);
+            for (std::size_t i = 0; i < perm.size(); i++) {
+               pl.arg_of_slot[slots.find(name[pos + i])] = perm[i];
+            }
+            p[static_cast<int>(f)].push_back(pl);
+         }
+      }
+
+      return p;
+   }();
+
+   return all.at(static_cast<int>(function));
+}
+
+/// one call of TSIL_Evaluate_ and the integrals read from it
+struct Ode_run {
+   std::array<TSIL_REAL, NUMBER_OF_MASSES> masses{};
+   std::array<bool, NUMBER_OF_MASSES> assigned{};
+   TSIL_REAL rs{0};            ///< Re(s)
+   TSIL_REAL is{0};            ///< Im(s)
+   TSIL_REAL qq{1};
+   bool qq_assigned{false};    ///< false if only M is read
+   std::vector<std::pair<std::size_t, std::string>> outputs; ///< integral index and TSIL name
+};
+
+/**
+ * Distributes the integrals onto as few TSIL_Evaluate_ runs as
+ * possible.  The integrals are placed greedily, integrals with many
+ * mass arguments first, into the run that requires the fewest new
+ * mass assignments.  Integrals with different s or Q^2 always end up
+ * in different runs.
+ */
+std::vector<Ode_run> plan_ode_runs(const std::vector<Integral>& integrals,
+                                   std::vector<std::size_t> indices)
+{
+   std::stable_sort(indices.begin(), indices.end(), [&] (std::size_t a, std::size_t b) {
+      return number_of_masses(integrals[a].function) > number_of_masses(integrals[b].function);
+   });
+
+   std::vector<Ode_run> runs;
+
+   for (const auto idx: indices) {
+      const auto& in = integrals[idx];
+      const auto n = number_of_masses(in.function);
+      const TSIL_REAL rs = in.args.at(n);
+      const TSIL_REAL is = in.args.at(n + 1);
+      const bool has_qq = in.function != Function::M;
+      const TSIL_REAL qq = has_qq ? in.args.at(n + 2) : 1;
+
+      Ode_run* best_run = nullptr;
+      const Placement* best_placement = nullptr;
+      int best_cost = NUMBER_OF_MASSES + 1;
+
+      for (auto& run: runs) {
+         if (run.rs != rs || run.is != is ||
+             (has_qq && run.qq_assigned && run.qq != qq)) {
+            continue;
+         }
+
+         for (const auto& pl: placements(in.function)) {
+            int cost = 0;
+            bool fits = true;
+
+            for (int j = 0; j < NUMBER_OF_MASSES && fits; j++) {
+               if (pl.arg_of_slot[j] < 0) {
+                  continue;
+               }
+               if (!run.assigned[j]) {
+                  cost++;
+               } else if (run.masses[j] != in.args[pl.arg_of_slot[j]]) {
+                  fits = false;
+               }
+            }
+
+            if (fits && cost < best_cost) {
+               best_run = &run;
+               best_placement = &pl;
+               best_cost = cost;
+            }
+         }
+      }
+
+      if (!best_run) {
+         runs.emplace_back();
+         best_run = &runs.back();
+         best_run->rs = rs;
+         best_run->is = is;
+         best_placement = &placements(in.function).front();
+      }
+
+      for (int j = 0; j < NUMBER_OF_MASSES; j++) {
+         if (best_placement->arg_of_slot[j] >= 0) {
+            best_run->masses[j] = in.args[best_placement->arg_of_slot[j]];
+            best_run->assigned[j] = true;
+         }
+      }
+
+      if (has_qq) {
+         best_run->qq = qq;
+         best_run->qq_assigned = true;
+      }
+
+      best_run->outputs.emplace_back(idx, best_placement->name);
+   }
+
+   return runs;
+}
+
+/**
+ * Returns the integral of the result with the given name, e.g. "Tvyz"
+ * for T(v,y,z,s,qq), for the parameters {x, y, z, u, v, Re(s), Im(s),
+ * qq}.
+ */
+Integral integral_of_result(const std::string& name, const Parameters& parsvec)
+{
+   const auto& names = result_names();
+
+   if (std::find(names.begin(), names.end(), name) == names.end()) {
+      throw std::runtime_error("Unknown output parameter " + name + ".");
+   }
+
+   const std::string slots = "xyzuv";
+   const auto pos = name.find_first_of(slots);
+   const auto prefix = name.substr(0, pos);
+
+   Integral in;
+   in.function = prefix == "TBAR" ? Function::Tbar : function_from_name(prefix);
+
+   for (auto i = pos; i < name.size(); i++) {
+      in.args.push_back(parsvec[slots.find(name[i])]);
+   }
+
+   const TSIL_REAL rs = parsvec[5], is = parsvec[6], qq = parsvec[7];
+
+   switch (in.function) {
+   case Function::A:
+   case Function::I:
+      in.args.insert(in.args.end(), { qq });
+      break;
+   case Function::M:
+      in.args.insert(in.args.end(), { rs, is });
+      break;
+   default:
+      in.args.insert(in.args.end(), { rs, is, qq });
+      break;
+   }
+
+   return in;
+}
+
+/******************************************************************/
+
+/// m2 + sum_k c_k F_k(rs)
+TSIL_COMPLEXCPP pole_equation(TSIL_COMPLEXCPP m2, const std::vector<Pole_term>& terms, TSIL_REAL rs)
+{
+   std::vector<Integral> integrals;
+   integrals.reserve(terms.size());
+
+   for (const auto& t: terms) {
+      Integral in = t.integral;
+      const int pos = s_position(in.function);
+
+      if (pos >= 0) {
+         in.args.at(pos) = rs;
+         in.args.at(pos + 1) = 0;
+      }
+
+      integrals.push_back(std::move(in));
+   }
+
+   const auto values = calculate_integrals(integrals);
+   TSIL_COMPLEXCPP result = m2;
+
+   for (std::size_t k = 0; k < terms.size(); k++) {
+      result += terms[k].coefficient*values[k];
+   }
+
+   return result;
+}
+
+/******************************************************************/
+
+/**
+ * Factor by which the numerical integration of TSIL is less precise
+ * than the machine epsilon in the generic case.
+ */
+constexpr TSIL_REAL ERROR_SAFETY_FACTOR = 100;
+
+/**
+ * Condition number of the evaluation at the given parameter point:
+ * max(|s|, masses)/|Re(s) - t| for the thresholds and
+ * pseudo-thresholds t of the two- and three-particle cuts, and the
+ * ratio of the largest to the smallest non-zero mass.
+ */
+TSIL_REAL condition_number(const Parameters& parsvec)
+{
+   const TSIL_REAL x = parsvec[0], y = parsvec[1], z = parsvec[2];
+   const TSIL_REAL u = parsvec[3], v = parsvec[4], rs = parsvec[5];
+
+   const TSIL_REAL max_mass = std::max({x, y, z, u, v});
+   const TSIL_REAL scale = std::max(std::abs(rs), max_mass);
+
+   if (scale == 0) {
+      return 1;
+   }
+
+   std::vector<TSIL_REAL> thresholds;
+
+   // cuts (x,z) and (y,u)
+   for (const auto& c: { std::make_pair(x, z), std::make_pair(y, u) }) {
+      const TSIL_REAL a = std::sqrt(c.first), b = std::sqrt(c.second);
+      thresholds.push_back((a + b)*(a + b));
+      if (a != b && a*b != 0) {
+         thresholds.push_back((a - b)*(a - b));
+      }
+   }
+
+   // cuts (v,y,z) and (u,x,v)
+   thresholds.push_back(std::pow(std::sqrt(v) + std::sqrt(y) + std::sqrt(z), 2));
+   thresholds.push_back(std::pow(std::sqrt(u) + std::sqrt(x) + std::sqrt(v), 2));
+
+   TSIL_REAL cond = 1;
+
+   for (const auto t: thresholds) {
+      // s = 0 is not a singular point if all masses of the cut vanish
+      if (t == 0 && rs == 0) {
+         continue;
+      }
+      const TSIL_REAL d = std::abs(rs - t);
+      if (d == 0) {
+         return std::numeric_limits<TSIL_REAL>::infinity();
+      }
+      cond = std::max(cond, scale/d);
+   }
+
+   TSIL_REAL min_mass = max_mass;
+
+   for (const auto m: { x, y, z, u, v }) {
+      if (m > 0) {
+         min_mass = std::min(min_mass, m);
+      }
+   }
+
+   if (min_mass > 0) {
+      cond = std::max(cond, max_mass/min_mass);
+   }
+
+   return cond;
+}
+
+/// |value - exact|/|exact|, or 0 if the exact value is zero or not finite
+TSIL_REAL relative_deviation(TSIL_COMPLEXCPP value, TSIL_COMPLEXCPP exact)
+{
+   const TSIL_REAL norm = std::abs(exact);
+
+   if (norm == 0 || !std::isfinite(norm)) {
+      return 0;
+   }
+
+   return std::abs(value - exact)/norm;
+}
+
+} // anonymous namespace
+
+/******************************************************************/
+
+/// names of the results, in the order of the array returned by TSILEvaluate
+const std::array<std::string, NUMBER_OF_RESULTS>& result_names()
+{
+   static const auto names = [] {
+#include "tsil_global.h"
+#include "tsil_names.h"
+
+      static_assert(NUMBER_OF_DATA_RESULTS == 1 // M
+         + NUM_U_FUNCS * NUM_U_PERMS // U
+         + 2 * NUM_T_FUNCS * NUM_T_PERMS // T and Tbar
+         + NUM_S_FUNCS * NUM_S_PERMS // S
+         + NUM_B_FUNCS * NUM_B_PERMS // B
+         + NUM_V_FUNCS * NUM_V_PERMS, // V
+         "NUMBER_OF_RESULTS does not match the TSIL function tables");
+
+      std::array<std::string, NUMBER_OF_RESULTS> n;
+      int k = 0;
+
+      n[k++] = "Mxyzuv";
+
+      for (const auto& func : uname) {
+         for (const auto& p : func) {
+            n[k++] = p;
+         }
+      }
+
+      for (const auto& func : tname) {
+         for (const auto& p : func) {
+            n[k++] = p;
+         }
+      }
+
+      for (const auto& func : tbarname) {
+         for (const auto& p : func) {
+            n[k++] = p;
+         }
+      }
+
+      for (const auto& func : sname) {
+         for (const auto& p : func) {
+            n[k++] = p;
+         }
+      }
+
+      for (const auto& func : bname) {
+         for (const auto& p : func) {
+            n[k++] = p;
+         }
+      }
+
+      for (const auto& func : vname) {
+         for (const auto& p : func) {
+            n[k++] = p;
+         }
+      }
+
+      for (const auto p : { "Ax", "Ay", "Az", "Au", "Av", "Ixyv", "Izuv" }) {
+         n[k++] = p;
+      }
+
+      return n;
+   }();
+
+   return names;
+}
+
+/******************************************************************/
+
+Function function_from_name(const std::string& name)
+{
+   const auto& names = function_names();
+
+   // Function::Evaluate is not an integral function
+   for (int k = 1; k < NUMBER_OF_FUNCTIONS; k++) {
+      if (name == names[k]) {
+         return static_cast<Function>(k);
+      }
+   }
+
+   throw std::runtime_error("Unknown integral function " + name + ".");
+}
+
+std::string function_name(Function function)
+{
+   return function_names().at(static_cast<int>(function));
+}
+
+std::size_t number_of_arguments(Function function)
+{
+   switch (function) {
+   case Function::A:
+   case Function::Ap:
+   case Function::Aeps:
+      return 2;
+   case Function::I:
+   case Function::Ip:
+   case Function::Ip2:
+   case Function::Ipp:
+   case Function::Ip3:
+      return 4;
+   case Function::B:
+   case Function::Bp:
+   case Function::dBds:
+   case Function::Beps:
+      return 5;
+   case Function::S:
+   case Function::T:
+   case Function::Tbar:
+      return 6;
+   case Function::M:
+   case Function::U:
+   case Function::V:
+      return 7;
+   default:
+      break;
+   }
+
+   return NUMBER_OF_PARAMETERS;
+}
+
+int s_position(Function function)
+{
+   switch (function) {
+   case Function::B:
+   case Function::Bp:
+   case Function::dBds:
+   case Function::Beps:
+      return 2;
+   case Function::S:
+   case Function::T:
+   case Function::Tbar:
+      return 3;
+   case Function::U:
+   case Function::V:
+      return 4;
+   case Function::M:
+      return 5;
+   default:
+      break;
+   }
+
+   return -1;
+}
+
+/******************************************************************/
+
+Parameters make_parameters(const std::vector<TSIL_REAL>& vec)
+{
+   if (vec.size() != NUMBER_OF_PARAMETERS) {
+      throw std::runtime_error(
+         "Expecting " + std::to_string(NUMBER_OF_PARAMETERS) +
+         " input parameters, but " + std::to_string(vec.size()) + " are given.");
+   }
+
+   Parameters pars;
+   std::copy(vec.begin(), vec.end(), pars.begin());
+
+   return pars;
+}
+
+Results calculate_results(const Parameters& parsvec)
+{
+   TSIL_DATA data{};
+   Results results;
+   calculate_results_cached(parsvec, data, results);
+
+   return results;
+}
+
+std::vector<Results> calculate_results(const std::vector<Parameters>& points,
+                                       std::vector<std::string>* messages)
+{
+   auto& pool = thread_pool();
+
+   // each worker owns its TSIL_DATA
+   std::vector<TSIL_DATA> workspace;
+   std::vector<Results> results(points.size());
+
+   if (messages) {
+      messages->assign(points.size(), {});
+   }
+
+   const auto setup = [&workspace] (std::size_t n_workers) { workspace.resize(n_workers); };
+
+   pool.parallel_for(points.size(), setup, [&] (std::size_t worker, std::size_t i) {
+      try {
+         calculate_results_cached(points[i], workspace[worker], results[i]);
+      } catch (...) {
+         if (messages) {
+            (*messages)[i] = take_diagnostics();
+         }
+         throw;
+      }
+      if (messages) {
+         (*messages)[i] = take_diagnostics();
+      }
+   });
+
+   return results;
+}
+
+std::size_t calculate_results_in_chunks(const std::vector<Parameters>& points,
+                                        std::vector<Results>& results,
+                                        const std::function<bool()>& abort,
+                                        std::vector<std::string>* messages)
+{
+   // time between two calls of abort()
+   constexpr double CHUNK_SECONDS = 0.1;
+
+   auto& pool = thread_pool();
+
+   // each worker owns its TSIL_DATA, the number of workers may change
+   // between the chunks
+   std::vector<TSIL_DATA> workspace;
+   std::size_t n_workers = pool.size();
+   results.resize(points.size());
+
+   if (messages) {
+      messages->assign(points.size(), {});
+   }
+
+   const auto setup = [&workspace, &n_workers] (std::size_t n) {
+      n_workers = n;
+      workspace.resize(std::max(workspace.size(), n));
+   };
+
+   // the first chunk has one point per worker
+   std::size_t chunk = n_workers;
+   std::size_t done = 0;
+
+   while (done < points.size()) {
+      const std::size_t n = std::min(chunk, points.size() - done);
+      const auto start = Clock::now();
+
+      pool.parallel_for(n, setup, [&] (std::size_t worker, std::size_t k) {
+         const std::size_t i = done + k;
+         try {
+            calculate_results_cached(points[i], workspace[worker], results[i]);
+         } catch (...) {
+            if (messages) {
+               (*messages)[i] = take_diagnostics();
+            }
+            throw;
+         }
+         if (messages) {
+            (*messages)[i] = take_diagnostics();
+         }
+      });
+
+      done += n;
+
+      if (done < points.size() && abort()) {
+         break;
+      }
+
+      // adapt the chunk size to the time per point, growing at most
+      // by a factor of 2 per chunk
+      const double seconds = seconds_since(start);
+      const double target = seconds > 0 ? n*CHUNK_SECONDS/seconds : 2.0*n;
+      chunk = static_cast<std::size_t>(std::min(target, 2.0*n));
+      chunk = std::max(chunk, n_workers);
+   }
+
+   return done;
+}
+
+std::vector<Results> calculate_sweep(const Parameters& pars,
+                                     const std::vector<TSIL_COMPLEXCPP>& s,
+                                     std::vector<std::string>* messages)
+{
+   // the results are calculated at Re(s), so each distinct Re(s) is
+   // evaluated only once
+   std::vector<TSIL_REAL> svals(s.size());
+   std::transform(s.begin(), s.end(), svals.begin(), [] (const TSIL_COMPLEXCPP& c) { return std::real(c); });
+   std::sort(svals.begin(), svals.end());
+   svals.erase(std::unique(svals.begin(), svals.end()), svals.end());
+
+   std::vector<Parameters> points(svals.size(), evaluated_point(pars));
+
+   for (std::size_t i = 0; i < svals.size(); i++) {
+      points[i][5] = svals[i];
+   }
+
+   // each worker owns its TSIL_DATA and sets the parameters only once,
+   // before its first evaluation
+   std::vector<TSIL_DATA> workspace;
+   std::vector<char> parameters_set;
+   std::vector<Results> sorted_results(points.size());
+   std::vector<std::string> sorted_messages(points.size());
+
+   const auto setup = [&] (std::size_t n_workers) {
+      workspace.resize(n_workers);
+      parameters_set.assign(n_workers, 0);
+   };
+
+   thread_pool().parallel_for(points.size(), setup, [&] (std::size_t worker, std::size_t i) {
+      bool is_set = parameters_set[worker] != 0;
+
+      try {
+         calculate_results_cached(points[i], workspace[worker], sorted_results[i], is_set);
+      } catch (...) {
+         sorted_messages[i] = take_diagnostics();
+         throw;
+      }
+
+      parameters_set[worker] = is_set;
+      sorted_messages[i] = take_diagnostics();
+   });
+
+   std::vector<Results> results(s.size());
+
+   if (messages) {
+      messages->assign(s.size(), {});
+   }
+
+   for (std::size_t i = 0; i < s.size(); i++) {
+      const auto k = std::lower_bound(svals.begin(), svals.end(), std::real(s[i])) - svals.begin();
+      results[i] = sorted_results[k];
+      if (messages) {
+         (*messages)[i] = sorted_messages[k];
+      }
+   }
+
+   return results;
+}
+
+TSIL_REAL estimate_error(const Parameters& parsvec, const Results& results)
+{
+   for (const auto& r: results) {
+      if (!std::isfinite(std::real(r)) || !std::isfinite(std::imag(r))) {
+         return std::numeric_limits<TSIL_REAL>::infinity();
+      }
+   }
+
+   TSIL_REAL error = ERROR_SAFETY_FACTOR*std::numeric_limits<TSIL_REAL>::epsilon()*condition_number(parsvec);
+
+   // compare with the results that are known analytically at this
+   // point, e.g. B(x,z), which TSIL_Evaluate_ obtains by integrating
+   // the differential equations
+   const auto& names = result_names();
+
+   for (int k = 0; k < NUMBER_OF_RESULTS; k++) {
+      TSIL_COMPLEXCPP exact;
+      if (calculate_without_ode(integral_of_result(names[k], evaluated_point(parsvec)), exact)) {
+         error = std::max(error, relative_deviation(results[k], exact));
+      }
+   }
+
+   return error;
+}
+
+std::vector<TSIL_COMPLEXCPP> calculate_results(const Parameters& parsvec,
+                                               const std::vector<std::string>& names)
+{
+   // as calculate_results(parsvec), evaluate at Re(s)
+   const Parameters point = evaluated_point(parsvec);
+   std::vector<Integral> integrals;
+   integrals.reserve(names.size());
+
+   for (const auto& name: names) {
+      integrals.push_back(integral_of_result(name, point));
+   }
+
+   return calculate_integrals(integrals);
+}
+
+/******************************************************************/
+
+TSIL_COMPLEXCPP rescale_integral(const Integral& integral, TSIL_COMPLEXCPP value, TSIL_REAL qq_new)
+{
+   const auto& a = integral.args;
+
+   if (integral.function == Function::Evaluate) {
+      throw std::runtime_error("Evaluate is not an integral function.");
+   }
+
+   if (a.size() != number_of_arguments(integral.function)) {
+      throw std::runtime_error(
+         "Expecting " + std::to_string(number_of_arguments(integral.function)) +
+         " arguments, but " + std::to_string(a.size()) + " are given.");
+   }
+
+   // M is independent of qq
+   if (integral.function == Function::M) {
+      return value;
+   }
+
+   const TSIL_REAL qq = a.back();
+
+   if (qq <= 0 || qq_new <= 0) {
+      throw std::runtime_error("The renormalization scale must be positive.");
+   }
+
+   if (qq == qq_new) {
+      return value;
+   }
+
+   // T(0,y,z), Ip(0,y,z), ... are infrared divergent
+   const bool divergent = a[0] == 0 &&
+      (integral.function == Function::T || integral.function == Function::Ip ||
+       integral.function == Function::Ip2 || integral.function == Function::Ip3);
+
+   if (divergent) {
+      return value;
+   }
+
+   const int pos = s_position(integral.function);
+   const TSIL_COMPLEXCPP s = pos >= 0 ? TSIL_COMPLEXCPP(a[pos], a[pos + 1]) : TSIL_COMPLEXCPP(0);
+
+   // L = log(qq_new/qq), the results are solutions of d/dL F = f(L)
+   const TSIL_REAL L = std::log(qq_new/qq);
+   const TSIL_REAL L2 = L*L/2; // L^2/2
+
+   const auto sum_x = [&a] { return a[0] + a[1] + a[2]; };
+   const auto sum_A = [&a, qq] { return TSIL_A_(a[0], qq) + TSIL_A_(a[1], qq) + TSIL_A_(a[2], qq); };
+
+   switch (integral.function) {
+   case Function::A:
+      return value - a[0]*L;
+   case Function::Ap:
+      return value - L;
+   case Function::Aeps:
+      return value + L*TSIL_A_(a[0], qq) - a[0]*L2;
+   case Function::B:
+      return value + L;
+   case Function::Bp:
+   case Function::dBds:
+   case Function::Ipp:
+      return value;
+   case Function::Beps:
+      return value + L*TSIL_B_(a[0], a[1], s, qq) + L2;
+   case Function::I:
+      return value + L*(sum_A() - sum_x()) - sum_x()*L2;
+   case Function::Ip:
+      return value + L*(std::log(a[0]/qq) - 1) - L2;
+   case Function::Ip2:
+      return value + L/a[0];
+   case Function::Ip3:
+      return value - L/(a[0]*a[0]);
+   case Function::S:
+      return value + L*(sum_A() - sum_x() + s/TSIL_REAL(2)) - sum_x()*L2;
+   case Function::T:
+      return value + L*(1 - std::log(a[0]/qq)) + L2;
+   case Function::Tbar:
+      return value + L*(TSIL_REAL(1) - TSIL_B_(a[1], a[2], s, qq)) - L2;
+   case Function::U:
+      return value + L*(TSIL_B_(a[0], a[1], s, qq) + TSIL_REAL(1)) + L2;
+   case Function::V:
+      return value - L*TSIL_Bp_(a[1], a[0], s, qq);
+   default:
+      break;
+   }
+
+   throw std::runtime_error("Cannot rescale unknown integral function.");
+}
+
+Results rescale_results(const Parameters& parsvec, const Results& results, TSIL_REAL qq_new)
+{
+   const auto& names = result_names();
+   const Parameters point = evaluated_point(parsvec);
+   Results rescaled;
+
+   for (int k = 0; k < NUMBER_OF_RESULTS; k++) {
+      rescaled[k] = rescale_integral(integral_of_result(names[k], point), results[k], qq_new);
+   }
+
+   return rescaled;
+}
+
+std::vector<TSIL_COMPLEXCPP> rescale_results(const Parameters& parsvec,
+                                             const std::vector<std::string>& names,
+                                             const std::vector<TSIL_COMPLEXCPP>& values,
+                                             TSIL_REAL qq_new)
+{
+   if (names.size() != values.size()) {
+      throw std::runtime_error("The number of names and values differ.");
+   }
+
+   const Parameters point = evaluated_point(parsvec);
+   std::vector<TSIL_COMPLEXCPP> rescaled(values.size());
+
+   for (std::size_t k = 0; k < values.size(); k++) {
+      rescaled[k] = rescale_integral(integral_of_result(names[k], point), values[k], qq_new);
+   }
+
+   return rescaled;
+}
+
+/******************************************************************/
+
+TSIL_COMPLEXCPP calculate_integral(const Integral& integral)
+{
+   return calculate_integrals({ integral }).front();
+}
+
+std::vector<TSIL_COMPLEXCPP> calculate_integrals(const std::vector<Integral>& integrals)
+{
+   std::vector<TSIL_COMPLEXCPP> values(integrals.size());
+   std::vector<std::size_t> pending;
+
+   // cache keys and their origins
+   std::vector<Normalized_integral> normalized;
+   std::vector<Cache_origin> origins;
+   normalized.reserve(integrals.size());
+   origins.reserve(integrals.size());
+
+   for (const auto& in: integrals) {
+      normalized.push_back(normalize(in));
+      const TSIL_REAL qq = in.function == Function::M ? 1 : in.args.back();
+      origins.push_back({normalized.back().scale > 0 ? normalized.back().scale : 1, qq});
+   }
+
+   // stores the value of integral i in the cache
+   const auto put = [&] (std::size_t i, TSIL_COMPLEXCPP value) {
+      const auto& ni = normalized[i];
+      if (ni.scale > 0) {
+         value = to_normalized(integrals[i], value, ni.scale);
+      }
+      cache_put(make_cache_key(ni.integral.function, ni.integral.args),
+                {{ value }, origins[i]});
+   };
+
+   for (std::size_t i = 0; i < integrals.size(); i++) {
+      const auto& in = integrals[i];
+      const auto& ni = normalized[i];
+      const auto key = make_cache_key(ni.integral.function, ni.integral.args);
+      auto& value = values[i];
+      Cache_origin hit_origin{};
+
+      const auto copy = [&value, &hit_origin] (const Cache_value& v) {
+         value = v.first.front();
+         hit_origin = v.second;
+      };
+
+      if (cache_get(key, copy)) {
+         update_statistics(in.function, [] (auto& st) { st.calls++; st.cache_hits++; });
+         if (hit_origin != origins[i]) {
+            rescaled_hits++;
+         }
+         if (ni.scale > 0) {
+            value = from_normalized(ni.integral, value, ni.scale, origins[i][1]);
+         }
+         continue;
+      }
+
+      const auto start = Clock::now();
+      const bool analytic = calculate_without_ode(in, value);
+      const double seconds = seconds_since(start);
+
+      update_statistics(in.function, [analytic, seconds] (auto& st) {
+         st.calls++;
+         st.analytic += analytic;
+         st.analytic_seconds += seconds;
+      });
+
+      if (analytic) {
+         put(i, value);
+      } else {
+         pending.push_back(i);
+      }
+   }
+
+   const auto runs = plan_ode_runs(integrals, pending);
+
+   auto& pool = thread_pool();
+   // each worker owns its TSIL_DATA
+   std::vector<TSIL_DATA> workspace;
+   std::vector<std::string> messages(runs.size());
+   std::vector<double> run_seconds(runs.size());
+
+   const auto setup = [&workspace] (std::size_t n_workers) { workspace.resize(n_workers); };
+
+   pool.parallel_for(runs.size(), setup, [&] (std::size_t worker, std::size_t r) {
+      const auto start = Clock::now();
+      const auto& run = runs[r];
+      auto& data = workspace[worker];
+      std::array<TSIL_REAL, NUMBER_OF_MASSES> m;
+
+      for (int j = 0; j < NUMBER_OF_MASSES; j++) {
+         m[j] = run.assigned[j] ? run.masses[j] : 1; // unused slots
+      }
+
+      TSIL_SetParameters_(&data, m[0], m[1], m[2], m[3], m[4], run.qq);
+      TSIL_Evaluate_(&data, run.rs);
+
+      for (const auto& out: run.outputs) {
+         values[out.first] = TSIL_GetFunction_(&data, out.second.c_str());
+      }
+
+      messages[r] = take_diagnostics();
+      run_seconds[r] = seconds_since(start);
+   });
+
+   for (const auto& m: messages) {
+      diagnostics() << m;
+   }
+
+   for (std::size_t r = 0; r < runs.size(); r++) {
+      const double share = run_seconds[r]/runs[r].outputs.size();
+      for (const auto& out: runs[r].outputs) {
+         update_statistics(integrals[out.first].function, [share] (auto& st) {
+            st.ode++;
+            st.ode_seconds += share;
+         });
+      }
+   }
+
+   for (const auto i: pending) {
+      put(i, values[i]);
+   }
+
+   return values;
+}
+
+/******************************************************************/
+
+Pole_result find_pole(TSIL_COMPLEXCPP m2, const std::vector<Pole_term>& terms,
+                      TSIL_REAL tolerance, int max_iterations)
+{
+   for (const auto& t: terms) {
+      if (t.integral.args.size() != number_of_arguments(t.integral.function)) {
+         throw std::runtime_error("Wrong number of arguments of an integral in the pole equation.");
+      }
+   }
+
+   Pole_result result;
+
+   // g(r) = Re(m2 + sum_k c_k F_k(r)) - r
+   const auto iterate = [&] (TSIL_REAL r) {
+      const auto s = pole_equation(m2, terms, r);
+      const TSIL_REAL g = std::real(s) - r;
+      result.iterations.push_back({s, std::abs(g)});
+      result.s = s;
+      result.converged = std::abs(g) < tolerance*std::max(TSIL_REAL(1), std::abs(r));
+      return g;
+   };
+
+   TSIL_REAL r0 = std::real(m2);
+   TSIL_REAL g0 = iterate(r0);
+   TSIL_REAL r1 = std::real(result.s); // fixed-point step
+
+   while (!result.converged && static_cast<int>(result.iterations.size()) < max_iterations) {
+      const TSIL_REAL g1 = iterate(r1);
+      const TSIL_REAL dg = g1 - g0;
+      // secant step, or fixed-point step if the secant is flat
+      const TSIL_REAL r2 = dg != 0 ? r1 - g1*(r1 - r0)/dg : std::real(result.s);
+      r0 = r1;
+      g0 = g1;
+      r1 = r2;
+   }
+
+   if (!result.converged) {
+      diagnostics() << "Pole search did not converge after "
+                    << result.iterations.size() << " iterations.\n";
+   }
+
+   return result;
+}
+
+/******************************************************************/
+
+Session::Session(TSIL_REAL x, TSIL_REAL y, TSIL_REAL z, TSIL_REAL u, TSIL_REAL v, TSIL_REAL qq)
+   : pars{x, y, z, u, v, 0, 0, qq}
+   , data(std::make_unique<TSIL_DATA>())
+{
+   set_parameters(pars, *data);
+}
+
+Session::~Session() = default;
+
+Results Session::evaluate(TSIL_COMPLEXCPP s)
+{
+   std::lock_guard<std::mutex> lock(mutex);
+
+   auto point = pars;
+   point[5] = std::real(s);
+   point[6] = std::imag(s);
+
+   Results results;
+   bool parameters_set = true;
+   calculate_results_cached(point, *data, results, parameters_set);
+
+   return results;
+}
+
+std::vector<TSIL_COMPLEXCPP> Session::evaluate(TSIL_COMPLEXCPP s, const std::vector<std::string>& names)
+{
+   const auto& all_names = result_names();
+   std::vector<std::size_t> indices;
+   indices.reserve(names.size());
+
+   for (const auto& name: names) {
+      const auto it = std::find(all_names.begin(), all_names.end(), name);
+      if (it == all_names.end()) {
+         throw std::runtime_error("Unknown output parameter " + name + ".");
+      }
+      indices.push_back(it - all_names.begin());
+   }
+
+   const auto results = evaluate(s);
+   std::vector<TSIL_COMPLEXCPP> values;
+   values.reserve(indices.size());
+
+   for (const auto i: indices) {
+      values.push_back(results[i]);
+   }
+
+   return values;
+}
+
+/******************************************************************/
+
+void set_number_of_threads(std::size_t n_threads)
+{
+   thread_pool().resize(n_threads);
+}
+
+std::size_t get_number_of_threads()
+{
+   return thread_pool().size();
+}
+
+Cache_statistics get_cache_statistics()
+{
+   const auto stats = result_cache().statistics();
+   return Cache_statistics{stats.hits, stats.misses, stats.entries, stats.bytes, stats.max_bytes,
+                           rescaled_hits};
+}
+
+void set_cache_size(std::size_t max_bytes)
+{
+   result_cache().set_max_bytes(max_bytes);
+}
+
+void clear_cache()
+{
+   result_cache().clear();
+   rescaled_hits = 0;
+}
+
+void set_result_store(const std::string& path, std::size_t max_bytes)
+{
+   auto store = path.empty() ? nullptr : std::make_shared<Result_store>(path, max_bytes);
+
+   std::lock_guard<std::mutex> lock(result_store_mutex);
+   result_store() = std::move(store);
+}
+
+Store_statistics get_store_statistics()
+{
+   const auto store = get_result_store();
+   return store ? store->statistics() : Store_statistics{};
+}
+
+std::array<Function_statistics, NUMBER_OF_FUNCTIONS> get_function_statistics()
+{
+   std::lock_guard<std::mutex> lock(function_statistics_mutex());
+   return function_statistics();
+}
+
+void reset_function_statistics()
+{
+   std::lock_guard<std::mutex> lock(function_statistics_mutex());
+   function_statistics().fill(Function_statistics{});
+}
+
+void set_cache_normalization(bool normalize)
+{
+   normalize_cache_keys = normalize;
+}
+
+bool get_cache_normalization()
+{
+   return normalize_cache_keys;
+}
+
+/******************************************************************/
+
+std::ostream& diagnostics()
+{
+   auto& buffer = diagnostics_buffer();
+
+   if (!buffer) {
+      buffer = std::make_unique<std::ostringstream>();
+   }
+
+   return *buffer;
+}
+
+std::string take_diagnostics()
+{
+   auto& buffer = diagnostics_buffer();
+
+   if (!buffer || buffer->tellp() <= 0) {
+      return {};
+   }
+
+   std::string str = buffer->str();
+   buffer->str({});
+
+   return str;
+}
+
+} // namespace tsil_mma
@@ -0,0 +1,299 @@
+// ====================================================================
+// This file is part of tsil-mma.
+//
+// tsil-mma is licenced under the GNU General Public License (GNU GPL)
+// version 3.
+// ====================================================================
+
+#ifndef TSIL_MMA_H
+#define TSIL_MMA_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "tsil_cpp.h"
+
+/**
+ * Evaluation engine of tsil-mma, independent of Mathematica.
+ *
+ * All functions are thread-safe.  Results are cached and repeated
+ * evaluations are distributed over a pool of threads.  Errors are
+ * reported by throwing std::runtime_error.
+ */
+namespace tsil_mma {
+
+/// number of input parameters {x, y, z, u, v, Re(s), Im(s), qq}
+constexpr int NUMBER_OF_PARAMETERS = 8;
+
+/// number of functions returned by calculate_results()
+constexpr int NUMBER_OF_RESULTS = 32;
+
+/// input parameters {x, y, z, u, v, Re(s), Im(s), qq}
+using Parameters = std::array<TSIL_REAL, NUMBER_OF_PARAMETERS>;
+
+/// values of all functions, in the order of result_names()
+using Results = std::array<TSIL_COMPLEXCPP, NUMBER_OF_RESULTS>;
+
+/// integral functions
+enum class Function : int {
+   Evaluate, A, Ap, Aeps, B, Bp, dBds, Beps, I, Ip, Ip2, Ipp, Ip3, M, S, T, Tbar, U, V
+};
+
+/// number of values of Function
+constexpr int NUMBER_OF_FUNCTIONS = 19;
+
+/// integral function and its arguments, as passed to the scalar
+/// library functions (e.g. {x, y, z, Re(s), Im(s), qq} for T)
+struct Integral {
+   Function function{Function::A};
+   std::vector<TSIL_REAL> args;
+};
+
+struct Cache_statistics {
+   std::uint64_t hits{0};
+   std::uint64_t misses{0};
+   std::size_t entries{0};
+   std::size_t bytes{0};      ///< estimated memory of the entries
+   std::size_t max_bytes{0};  ///< memory limit
+   std::uint64_t rescaled_hits{0}; ///< hits on entries calculated at a different scale or qq
+};
+
+struct Store_statistics {
+   std::uint64_t hits{0};
+   std::uint64_t misses{0};
+   std::uint64_t rejected{0}; ///< entries not stored because the store is full
+   std::size_t entries{0};
+   std::size_t bytes{0};      ///< size of the entries in the file
+   std::size_t max_bytes{0};  ///< capacity of the file
+};
+
+/**
+ * Counters of the calculations of an integral function.  For
+ * Function::Evaluate, each calculation of all results is counted as
+ * one TSIL_Evaluate_ run.
+ */
+struct Function_statistics {
+   std::uint64_t calls{0};      ///< number of requested values
+   std::uint64_t cache_hits{0}; ///< values taken from the result cache
+   std::uint64_t analytic{0};   ///< values calculated analytically
+   std::uint64_t ode{0};        ///< values calculated with TSIL_Evaluate_
+   double analytic_seconds{0};  ///< time of the analytic calculations, including failed attempts
+   double ode_seconds{0};       ///< time of TSIL_Evaluate_, shared equally by the values of one run
+};
+
+/// names of the results, i.e. {"Mxyzuv", "Uzxyv", ..., "Izuv"}
+const std::array<std::string, NUMBER_OF_RESULTS>& result_names();
+
+/// returns the function with the given name, e.g. "Tbar"
+Function function_from_name(const std::string&);
+
+/// returns the name of the function, e.g. "Tbar" (or "Evaluate")
+std::string function_name(Function);
+
+/// number of arguments of the function
+std::size_t number_of_arguments(Function);
+
+/// position of s in the arguments, if s is passed as a single complex
+/// number (-1 if the function does not depend on s)
+int s_position(Function);
+
+/// converts a list of 8 numbers to parameters
+Parameters make_parameters(const std::vector<TSIL_REAL>&);
+
+/// calculates all results for one parameter point
+Results calculate_results(const Parameters&);
+
+/**
+ * Calculates all results for a list of parameter points in parallel.
+ * If messages is not null, the diagnostic output of point i is stored
+ * in (*messages)[i].
+ */
+std::vector<Results> calculate_results(const std::vector<Parameters>&,
+                                       std::vector<std::string>* messages = nullptr);
+
+/**
+ * Calculates all results for a list of parameter points in parallel,
+ * in chunks of adaptive size, such that each chunk takes about 0.1
+ * seconds.  After each chunk abort() is called; if it returns true,
+ * the remaining points are skipped.  Returns the number of calculated
+ * points, which are the first ones of results.  If messages is not
+ * null, the diagnostic output of point i is stored in (*messages)[i].
+ */
+std::size_t calculate_results_in_chunks(const std::vector<Parameters>&,
+                                        std::vector<Results>& results,
+                                        const std::function<bool()>& abort,
+                                        std::vector<std::string>* messages = nullptr);
+
+/**
+ * Calculates all results at several values of s for the masses and qq
+ * of the given parameters (whose s is ignored).  As in
+ * calculate_results(), the results are taken at Re(s).  The distinct
+ * values of Re(s) are evaluated once each, in parallel, where each
+ * thread sets the masses only once.  If messages is not null, the
+ * diagnostic output of s[i] is stored in (*messages)[i].
+ */
+std::vector<Results> calculate_sweep(const Parameters&,
+                                     const std::vector<TSIL_COMPLEXCPP>& s,
+                                     std::vector<std::string>* messages = nullptr);
+
+/**
+ * Estimates the relative error of the results calculated with the
+ * precision of TSIL_REAL at the given parameter point.  The estimate
+ * is the larger of the machine epsilon times a condition number,
+ * which grows near the (pseudo-)thresholds of s and with the ratio of
+ * the largest to the smallest non-zero mass, and the largest relative
+ * deviation of the results from the functions known analytically at
+ * this point (A, B, I and the analytic cases of M, S, T, U, V).
+ * Non-finite results have an infinite error.
+ */
+TSIL_REAL estimate_error(const Parameters&, const Results&);
+
+/// calculates only the results with the given names (at Re(s), as all results)
+std::vector<TSIL_COMPLEXCPP> calculate_results(const Parameters&,
+                                               const std::vector<std::string>& names);
+
+/// calculates one integral function
+TSIL_COMPLEXCPP calculate_integral(const Integral&);
+
+/**
+ * Calculates a list of integral functions.  Integrals that are cached
+ * or known analytically are not integrated numerically.  The remaining
+ * ones are grouped into as few TSIL_Evaluate_ runs as possible.
+ */
+std::vector<TSIL_COMPLEXCPP> calculate_integrals(const std::vector<Integral>&);
+
+/**
+ * Transports the value of an integral function from the
+ * renormalization scale qq of its arguments to qq_new, using the
+ * analytic dependence of the integral functions on log(qq).
+ */
+TSIL_COMPLEXCPP rescale_integral(const Integral&, TSIL_COMPLEXCPP value, TSIL_REAL qq_new);
+
+/**
+ * Transports all results from the qq of the parameters to qq_new.  As
+ * in calculate_results(), the results are taken at Re(s), i.e. Im(s)
+ * of the parameters is ignored.
+ */
+Results rescale_results(const Parameters&, const Results&, TSIL_REAL qq_new);
+
+/// rescale_results() for the results with the given names
+std::vector<TSIL_COMPLEXCPP> rescale_results(const Parameters&,
+                                             const std::vector<std::string>& names,
+                                             const std::vector<TSIL_COMPLEXCPP>& values,
+                                             TSIL_REAL qq_new);
+
+/// term c*F(s) of a self-energy, where F is an integral function of s
+struct Pole_term {
+   TSIL_COMPLEXCPP coefficient;
+   Integral integral; ///< the s given in the arguments is ignored
+};
+
+struct Pole_iteration {
+   TSIL_COMPLEXCPP s;  ///< m2 + sum_k c_k F_k(Re(s)) of the iteration
+   TSIL_REAL residual; ///< |Re(s) - Re(s) of the arguments|
+};
+
+struct Pole_result {
+   TSIL_COMPLEXCPP s;                    ///< pole
+   bool converged{false};
+   std::vector<Pole_iteration> iterations;
+};
+
+/**
+ * Finds the complex pole s = m2 + sum_k c_k F_k(s).  As TSIL supports
+ * only real s, the integrals are evaluated at Re(s): the real part is
+ * iterated until |Re(s) - Re(m2 + sum_k c_k F_k(Re(s)))| < tolerance *
+ * max(1, |Re(s)|), starting with a fixed-point step from Re(m2),
+ * followed by secant steps.
+ */
+Pole_result find_pole(TSIL_COMPLEXCPP m2, const std::vector<Pole_term>& terms,
+                      TSIL_REAL tolerance = 1e-12L, int max_iterations = 100);
+
+/**
+ * TSIL_DATA with fixed masses and qq, for evaluations at different
+ * values of s.  Only the parameter setup (TSIL_SetParameters_) is done
+ * once; each evaluation still integrates the differential equations
+ * from scratch, unless the results are known analytically or cached.
+ */
+class Session {
+public:
+   Session(TSIL_REAL x, TSIL_REAL y, TSIL_REAL z, TSIL_REAL u, TSIL_REAL v, TSIL_REAL qq);
+   ~Session();
+
+   Session(const Session&) = delete;
+   Session& operator=(const Session&) = delete;
+
+   /// calculates all results at s
+   Results evaluate(TSIL_COMPLEXCPP s);
+
+   /// calculates the results with the given names at s
+   std::vector<TSIL_COMPLEXCPP> evaluate(TSIL_COMPLEXCPP s, const std::vector<std::string>& names);
+
+private:
+   std::mutex mutex;                ///< serializes the evaluations
+   Parameters pars{};               ///< masses and qq
+   std::unique_ptr<TSIL_DATA> data; ///< initialized with pars
+};
+
+/// sets the number of threads (0 = one per core)
+void set_number_of_threads(std::size_t);
+
+std::size_t get_number_of_threads();
+
+Cache_statistics get_cache_statistics();
+
+/// sets the memory limit of the result cache in bytes (0 = disabled)
+void set_cache_size(std::size_t);
+
+/// statistics of all functions, indexed by static_cast<int>(Function)
+std::array<Function_statistics, NUMBER_OF_FUNCTIONS> get_function_statistics();
+
+/// resets the statistics of all functions
+void reset_function_statistics();
+
+/// removes all cached results and resets the counters
+void clear_cache();
+
+/// default capacity of the persistent result store in bytes
+constexpr std::size_t DEFAULT_STORE_SIZE = std::size_t(1) << 30;
+
+/**
+ * Opens the persistent result store in the given file, which is
+ * created with a capacity of max_bytes if it does not exist.  Results
+ * that are not found in the in-memory cache are looked up in the
+ * store, and new results are appended to it.  The file can be shared
+ * by several processes.  An empty path closes the store.
+ */
+void set_result_store(const std::string& path, std::size_t max_bytes = DEFAULT_STORE_SIZE);
+
+/// statistics of the persistent result store (all zero if closed)
+Store_statistics get_store_statistics();
+
+/**
+ * Enables or disables the normalization of cache keys (default:
+ * disabled).  If enabled, the masses and s are divided by the largest
+ * of them and qq is set to 1, so that points which differ by an
+ * overall scale or by qq share one cache entry.  The results are
+ * transported back with the homogeneity relations and the analytic
+ * dependence on log(qq), see rescale_integral().
+ */
+void set_cache_normalization(bool);
+
+bool get_cache_normalization();
+
+/// returns the diagnostic output stream of the calling thread
+std::ostream& diagnostics();
+
+/// returns and clears the diagnostic output of the calling thread
+std::string take_diagnostics();
+
+} // namespace tsil_mma
+
+#endif
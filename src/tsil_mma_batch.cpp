@@ -0,0 +1,418 @@
+// ====================================================================
+// This file is part of tsil-mma.
+//
+// tsil-mma is licenced under the GNU General Public License (GNU GPL)
+// version 3.
+// ====================================================================
+
+// Evaluation of parameter points without Mathematica.  Usage:
+//
+//   tsil-mma-batch [options] <input> <output>
+//
+// Each input row contains {x, y, z, u, v, Re(s), Im(s), qq}, either as
+// 8 doubles in a binary file, which is memory-mapped, or as 8
+// comma-separated numbers in a CSV file ("-" reads from stdin).  Each
+// output row contains the 32 results ordered as result_names(), as 64
+// doubles {Re, Im, ...} in a binary file or as CSV ("-" writes to
+// stdout).  The rows are processed in chunks, so the memory use does
+// not depend on the number of rows.
+
+#include "tsil_mma.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+using namespace tsil_mma;
+
+enum class Format { Binary, CSV };
+
+constexpr std::size_t DEFAULT_CHUNK_SIZE = 16384;
+
+void print_usage(const char* program)
+{
+   std::cerr << "Usage: " << program << " [options] <input> <output>\n\n"
+             << "Options:\n"
+             << "  --input-format binary|csv   (default: csv for *.csv and -, otherwise binary)\n"
+             << "  --output-format binary|csv  (default: csv for *.csv and -, otherwise binary)\n"
+             << "  --chunk-size <rows>         rows evaluated at once (default: "
+             << DEFAULT_CHUNK_SIZE << ")\n"
+             << "  --threads <n>               number of threads (default: one per core)\n"
+             << "  --cache-size <bytes>        memory limit of the result cache (default: 64 MiB)\n"
+             << "  --store <file>              persistent result store\n";
+}
+
+Format parse_format(const std::string& str)
+{
+   if (str == "binary") {
+      return Format::Binary;
+   }
+   if (str == "csv") {
+      return Format::CSV;
+   }
+   throw std::runtime_error("Unknown format " + str + ".");
+}
+
+Format format_from_name(const std::string& path)
+{
+   const std::string ext(".csv");
+
+   if (path == "-" || (path.size() >= ext.size() &&
+                       path.compare(path.size() - ext.size(), ext.size(), ext) == 0)) {
+      return Format::CSV;
+   }
+
+   return Format::Binary;
+}
+
+/******************************************************************/
+
+/// source of parameter rows
+class Reader {
+public:
+   virtual ~Reader() = default;
+   /// reads up to n rows into points, returns false at the end of the input
+   virtual bool read(std::size_t n, std::vector<Parameters>& points) = 0;
+};
+
+/// rows of 8 doubles in a memory-mapped file
+class Binary_reader : public Reader {
+public:
+   explicit Binary_reader(const std::string& path)
+   {
+      fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+      if (fd < 0) {
+         throw std::runtime_error("Cannot open " + path + ": " + std::strerror(errno));
+      }
+
+      struct stat st;
+      if (fstat(fd, &st) != 0) {
+         throw std::runtime_error("Cannot stat " + path + ": " + std::strerror(errno));
+      }
+
+      constexpr std::size_t row_bytes = NUMBER_OF_PARAMETERS*sizeof(double);
+      bytes = static_cast<std::size_t>(st.st_size);
+
+      if (bytes % row_bytes != 0) {
+         throw std::runtime_error("The size of " + path + " is not a multiple of "
+                                  + std::to_string(row_bytes) + " bytes.");
+      }
+
+      n_rows = bytes/row_bytes;
+
+      if (bytes > 0) {
+         data = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+         if (data == MAP_FAILED) {
+            data = nullptr;
+            throw std::runtime_error("Cannot map " + path + ": " + std::strerror(errno));
+         }
+         madvise(data, bytes, MADV_SEQUENTIAL);
+      }
+   }
+
+   ~Binary_reader() override
+   {
+      if (data) {
+         munmap(data, bytes);
+      }
+      if (fd >= 0) {
+         close(fd);
+      }
+   }
+
+   bool read(std::size_t n, std::vector<Parameters>& points) override
+   {
+      points.clear();
+
+      if (row >= n_rows) {
+         return false;
+      }
+
+      const auto* in = static_cast<const double*>(data);
+      const std::size_t end = std::min(n_rows, row + n);
+
+      for (std::size_t i = row; i < end; i++) {
+         Parameters p;
+         std::copy(in + i*NUMBER_OF_PARAMETERS, in + (i + 1)*NUMBER_OF_PARAMETERS, p.begin());
+         points.push_back(p);
+      }
+
+      // drop the pages of the finished rows, so that the resident
+      // memory does not grow with the file
+      const std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+      const std::size_t done = (end*NUMBER_OF_PARAMETERS*sizeof(double))/page*page;
+      if (done > 0) {
+         madvise(data, done, MADV_DONTNEED);
+      }
+
+      row = end;
+
+      return true;
+   }
+
+private:
+   int fd{-1};
+   void* data{nullptr};
+   std::size_t bytes{0};
+   std::size_t n_rows{0};
+   std::size_t row{0};
+};
+
+/// rows of 8 comma-separated numbers, empty lines and lines starting with # are skipped
+class CSV_reader : public Reader {
+public:
+   explicit CSV_reader(const std::string& path)
+   {
+      if (path != "-") {
+         file.open(path);
+         if (!file) {
+            throw std::runtime_error("Cannot open " + path + ".");
+         }
+      }
+      in = path == "-" ? &std::cin : &file;
+   }
+
+   bool read(std::size_t n, std::vector<Parameters>& points) override
+   {
+      points.clear();
+
+      std::string line;
+
+      while (points.size() < n && std::getline(*in, line)) {
+         line_number++;
+
+         if (line.empty() || line[0] == '#' || line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+         }
+
+         points.push_back(parse(line));
+      }
+
+      return !points.empty();
+   }
+
+private:
+   std::ifstream file;
+   std::istream* in{nullptr};
+   std::size_t line_number{0};
+
+   std::runtime_error invalid_line() const
+   {
+      return std::runtime_error("Line " + std::to_string(line_number) + ": expected "
+                                + std::to_string(NUMBER_OF_PARAMETERS) + " comma-separated numbers.");
+   }
+
+   Parameters parse(const std::string& line) const
+   {
+      Parameters p;
+      const char* str = line.c_str();
+
+      for (int k = 0; k < NUMBER_OF_PARAMETERS; k++) {
+         char* end = nullptr;
+         p[k] = std::strtold(str, &end);
+
+         if (end == str) {
+            throw invalid_line();
+         }
+
+         str = end;
+         while (*str == ' ' || *str == '\t') {
+            str++;
+         }
+         if (k + 1 < NUMBER_OF_PARAMETERS && *str++ != ',') {
+            throw invalid_line();
+         }
+      }
+
+      if (std::strspn(str, " \t\r") != std::strlen(str)) {
+         throw invalid_line();
+      }
+
+      return p;
+   }
+};
+
+/******************************************************************/
+
+/// writes the results as machine numbers, as put_results() in the LibraryLink
+class Writer {
+public:
+   Writer(const std::string& path, Format format_) : format(format_)
+   {
+      if (path != "-") {
+         file.open(path, format == Format::Binary ? std::ios::binary : std::ios::out);
+         if (!file) {
+            throw std::runtime_error("Cannot open " + path + ".");
+         }
+      }
+
+      out = path == "-" ? &std::cout : &file;
+
+      if (format == Format::CSV) {
+         out->precision(std::numeric_limits<double>::max_digits10);
+
+         const auto& names = result_names();
+         for (int k = 0; k < NUMBER_OF_RESULTS; k++) {
+            *out << (k ? "," : "") << "Re(" << names[k] << "),Im(" << names[k] << ')';
+         }
+         *out << '\n';
+      }
+   }
+
+   void write(const std::vector<Results>& results)
+   {
+      if (format == Format::Binary) {
+         std::vector<double> row(2*NUMBER_OF_RESULTS);
+
+         for (const auto& res: results) {
+            for (int k = 0; k < NUMBER_OF_RESULTS; k++) {
+               row[2*k] = static_cast<double>(std::real(res[k]));
+               row[2*k + 1] = static_cast<double>(std::imag(res[k]));
+            }
+            out->write(reinterpret_cast<const char*>(row.data()), row.size()*sizeof(double));
+         }
+      } else {
+         for (const auto& res: results) {
+            for (int k = 0; k < NUMBER_OF_RESULTS; k++) {
+               *out << (k ? "," : "") << static_cast<double>(std::real(res[k]))
+                    << ',' << static_cast<double>(std::imag(res[k]));
+            }
+            *out << '\n';
+         }
+      }
+
+      if (!*out) {
+         throw std::runtime_error("Cannot write the results.");
+      }
+   }
+
+   void flush()
+   {
+      out->flush();
+      if (!*out) {
+         throw std::runtime_error("Cannot write the results.");
+      }
+   }
+
+private:
+   Format format;
+   std::ofstream file;
+   std::ostream* out{nullptr};
+};
+
+} // anonymous namespace
+
+int main(int argc, char* argv[])
+{
+   std::vector<std::string> files;
+   std::string input_format, output_format, store_path;
+   std::size_t chunk_size = DEFAULT_CHUNK_SIZE;
+
+   try {
+      for (int i = 1; i < argc; i++) {
+         const std::string arg(argv[i]);
+
+         if (arg.size() > 2 && arg.compare(0, 2, "--") == 0) {
+            if (i + 1 >= argc) {
+               print_usage(argv[0]);
+               return EXIT_FAILURE;
+            }
+
+            const std::string value(argv[++i]);
+
+            if (arg == "--input-format") {
+               input_format = value;
+            } else if (arg == "--output-format") {
+               output_format = value;
+            } else if (arg == "--chunk-size") {
+               chunk_size = std::max<std::size_t>(1, std::stoull(value));
+            } else if (arg == "--threads") {
+               set_number_of_threads(std::stoull(value));
+            } else if (arg == "--cache-size") {
+               set_cache_size(std::stoull(value));
+            } else if (arg == "--store") {
+               store_path = value;
+            } else {
+               print_usage(argv[0]);
+               return EXIT_FAILURE;
+            }
+         } else {
+            files.push_back(arg);
+         }
+      }
+
+      if (files.size() != 2) {
+         print_usage(argv[0]);
+         return EXIT_FAILURE;
+      }
+
+      const Format in_fmt = input_format.empty() ? format_from_name(files[0]) : parse_format(input_format);
+      const Format out_fmt = output_format.empty() ? format_from_name(files[1]) : parse_format(output_format);
+
+      if (in_fmt == Format::Binary && files[0] == "-") {
+         throw std::runtime_error("Binary input cannot be read from stdin, use --input-format csv.");
+      }
+
+      if (!store_path.empty()) {
+         set_result_store(store_path);
+      }
+
+      std::unique_ptr<Reader> reader;
+      if (in_fmt == Format::Binary) {
+         reader = std::make_unique<Binary_reader>(files[0]);
+      } else {
+         reader = std::make_unique<CSV_reader>(files[0]);
+      }
+
+      Writer writer(files[1], out_fmt);
+
+      const auto start = std::chrono::steady_clock::now();
+      std::vector<Parameters> points;
+      std::vector<std::string> messages;
+      std::size_t n_done = 0;
+
+      while (reader->read(chunk_size, points)) {
+         const auto results = calculate_results(points, &messages);
+
+         for (std::size_t i = 0; i < messages.size(); i++) {
+            std::istringstream lines(messages[i]);
+            std::string line;
+            while (std::getline(lines, line)) {
+               std::cerr << "Point " << (n_done + i + 1) << ": " << line << '\n';
+            }
+         }
+
+         writer.write(results);
+         n_done += points.size();
+      }
+
+      writer.flush();
+
+      const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+      std::cerr << "Evaluated " << n_done << " points in " << elapsed.count() << " s" << std::endl;
+   } catch (const std::exception& e) {
+      std::cerr << "Error: " << e.what() << std::endl;
+      return EXIT_FAILURE;
+   }
+
+   return EXIT_SUCCESS;
+}
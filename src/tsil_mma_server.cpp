@@ -0,0 +1,299 @@
+// ====================================================================
+// This file is part of tsil-mma.
+//
+// tsil-mma is licenced under the GNU General Public License (GNU GPL)
+// version 3.
+// ====================================================================
+
+// Evaluation server shared by several processes on one node (see
+// protocol.h).  Usage:
+//
+//   tsil-mma-server [--socket <path>] [--threads <n>]
+//                   [--cache-size <bytes>] [--store <file> [--store-size <bytes>]]
+//
+// The requests of all clients are collected and evaluated together on
+// one thread pool with one result cache.  The diagnostic output of each
+// point and the errors are returned to the client that sent the point.
+
+#include "protocol.h"
+#include "tsil_mma.h"
+
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <future>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+using namespace tsil_mma;
+
+char socket_file[108] = {0};
+
+void print_usage(const char* program)
+{
+   std::cerr << "Usage: " << program << " [--socket <path>] [--threads <n>]"
+             << " [--cache-size <bytes>] [--store <file> [--store-size <bytes>]]\n";
+}
+
+void remove_socket_and_exit(int)
+{
+   unlink(socket_file);
+   _exit(EXIT_SUCCESS);
+}
+
+/******************************************************************/
+
+/// results of a request and the diagnostic output of each point
+struct Reply {
+   std::vector<Results> results;
+   std::vector<std::string> messages;
+};
+
+/**
+ * Collects the requests of all connections.  Whenever the pool
+ * becomes idle, all pending requests are concatenated and calculated
+ * with one call of calculate_results().  If this fails, the requests
+ * are calculated one by one, so that an error is only reported to the
+ * client whose request caused it.
+ */
+class Dispatcher {
+public:
+   Dispatcher() : worker([this] { run(); }) {}
+
+   ~Dispatcher()
+   {
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         stop = true;
+      }
+      cv.notify_one();
+      worker.join();
+   }
+
+   std::future<Reply> submit(std::vector<Parameters> points)
+   {
+      auto req = std::make_shared<Request>();
+      req->points = std::move(points);
+      auto result = req->results.get_future();
+
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         pending.push_back(std::move(req));
+      }
+      cv.notify_one();
+
+      return result;
+   }
+
+private:
+   struct Request {
+      std::vector<Parameters> points;
+      std::promise<Reply> results;
+   };
+
+   std::mutex mutex;
+   std::condition_variable cv;
+   std::deque<std::shared_ptr<Request>> pending;
+   bool stop{false};
+   std::thread worker;
+
+   void run()
+   {
+      while (true) {
+         std::deque<std::shared_ptr<Request>> batch;
+
+         {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this] { return stop || !pending.empty(); });
+            if (stop) {
+               return;
+            }
+            batch.swap(pending);
+         }
+
+         if (batch.size() == 1 || !evaluate_together(batch)) {
+            for (const auto& req: batch) {
+               evaluate(*req);
+            }
+         }
+      }
+   }
+
+   /// returns false if the batch must be evaluated request by request
+   static bool evaluate_together(const std::deque<std::shared_ptr<Request>>& batch)
+   {
+      std::vector<Parameters> points;
+      for (const auto& req: batch) {
+         points.insert(points.end(), req->points.cbegin(), req->points.cend());
+      }
+
+      Reply all;
+
+      try {
+         all.results = calculate_results(points, &all.messages);
+      } catch (...) {
+         return false;
+      }
+
+      std::size_t first = 0;
+      for (const auto& req: batch) {
+         const std::size_t last = first + req->points.size();
+         Reply reply;
+         reply.results.assign(all.results.begin() + first, all.results.begin() + last);
+         reply.messages.assign(std::make_move_iterator(all.messages.begin() + first),
+                               std::make_move_iterator(all.messages.begin() + last));
+         req->results.set_value(std::move(reply));
+         first = last;
+      }
+
+      return true;
+   }
+
+   static void evaluate(Request& req)
+   {
+      try {
+         Reply reply;
+         reply.results = calculate_results(req.points, &reply.messages);
+         req.results.set_value(std::move(reply));
+      } catch (...) {
+         req.results.set_exception(std::current_exception());
+      }
+   }
+};
+
+/******************************************************************/
+
+void serve_client(int fd, Dispatcher& dispatcher)
+{
+   try {
+      Message_header header;
+
+      while (read_header(fd, header)) {
+         if (header.magic != PROTOCOL_MAGIC ||
+             header.type != static_cast<std::uint32_t>(Message_type::Evaluate_batch) ||
+             header.size > MAX_POINTS_PER_MESSAGE) {
+            throw std::runtime_error("Invalid request.");
+         }
+
+         const std::size_t n = header.size;
+         std::vector<double> input(n*NUMBER_OF_PARAMETERS);
+         read_exact(fd, input.data(), input.size()*sizeof(double));
+
+         std::vector<Parameters> points(n);
+         for (std::size_t i = 0; i < n; ++i) {
+            for (int k = 0; k < NUMBER_OF_PARAMETERS; ++k) {
+               points[i][k] = input[i*NUMBER_OF_PARAMETERS + k];
+            }
+         }
+
+         try {
+            const auto reply = dispatcher.submit(std::move(points)).get();
+            const auto& results = reply.results;
+
+            std::vector<double> output(n*NUMBER_OF_RESULTS*2);
+            for (std::size_t i = 0; i < n; ++i) {
+               for (int k = 0; k < NUMBER_OF_RESULTS; ++k) {
+                  output[2*(i*NUMBER_OF_RESULTS + k)] = std::real(results[i][k]);
+                  output[2*(i*NUMBER_OF_RESULTS + k) + 1] = std::imag(results[i][k]);
+               }
+            }
+
+            write_diagnostics(fd, reply.messages);
+            write_message(fd, Message_type::Results, n, output.data(), output.size()*sizeof(double));
+         } catch (const std::exception& e) {
+            const std::string msg = std::string(e.what()).substr(0, 1024);
+            write_message(fd, Message_type::Error, msg.size(), msg.data(), msg.size());
+         }
+      }
+   } catch (const std::exception& e) {
+      std::cerr << "Connection closed: " << e.what() << std::endl;
+   }
+
+   close(fd);
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[])
+{
+   std::string socket_path = default_socket_path();
+   std::string store_path;
+   std::size_t store_size = DEFAULT_STORE_SIZE;
+
+   try {
+      for (int i = 1; i < argc; i += 2) {
+         const std::string option(argv[i]);
+
+         if (i + 1 >= argc) {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+         }
+
+         const std::string value(argv[i + 1]);
+
+         if (option == "--socket") {
+            socket_path = value;
+         } else if (option == "--threads") {
+            set_number_of_threads(std::stoull(value));
+         } else if (option == "--cache-size") {
+            set_cache_size(std::stoull(value));
+         } else if (option == "--store") {
+            store_path = value;
+         } else if (option == "--store-size") {
+            store_size = std::stoull(value);
+         } else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+         }
+      }
+
+      if (!store_path.empty()) {
+         set_result_store(store_path, store_size);
+      }
+
+      const int listener = listen_on_socket(socket_path);
+
+      std::strncpy(socket_file, socket_path.c_str(), sizeof(socket_file) - 1);
+      std::signal(SIGINT, remove_socket_and_exit);
+      std::signal(SIGTERM, remove_socket_and_exit);
+
+      std::cerr << "tsil-mma-server: listening on " << socket_path
+                << " with " << get_number_of_threads() << " threads" << std::endl;
+
+      Dispatcher dispatcher;
+
+      while (true) {
+         const int fd = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+         if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+               continue;
+            }
+            throw std::runtime_error(std::string("accept failed: ") + std::strerror(errno));
+         }
+         std::thread(serve_client, fd, std::ref(dispatcher)).detach();
+      }
+   } catch (const std::exception& e) {
+      std::cerr << "Error: " << e.what() << std::endl;
+      if (socket_file[0] != '\0') {
+         unlink(socket_file);
+      }
+      return EXIT_FAILURE;
+   }
+
+   return EXIT_SUCCESS;
+}
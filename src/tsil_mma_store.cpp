@@ -0,0 +1,81 @@
+// ====================================================================
+// This file is part of tsil-mma.
+//
+// tsil-mma is licenced under the GNU General Public License (GNU GPL)
+// version 3.
+// ====================================================================
+
+// Maintenance of the persistent result store (see result_store.h).
+// Usage:
+//
+//   tsil-mma-store info <file>
+//   tsil-mma-store compact <file> [capacity in bytes]
+
+#include "result_store.h"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include <sys/stat.h>
+
+namespace {
+
+void print_usage(const char* program)
+{
+   std::cerr << "Usage:\n"
+             << "  " << program << " info <file>\n"
+             << "  " << program << " compact <file> [capacity in bytes]\n";
+}
+
+bool file_exists(const std::string& path)
+{
+   struct stat st;
+   return stat(path.c_str(), &st) == 0;
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[])
+{
+   using namespace tsil_mma;
+
+   if (argc < 3 || argc > 4) {
+      print_usage(argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   const std::string command(argv[1]);
+   const std::string path(argv[2]);
+
+   try {
+      if (!file_exists(path)) {
+         throw std::runtime_error("File " + path + " does not exist.");
+      }
+
+      if (command == "info" && argc == 3) {
+         Result_store store(path, DEFAULT_STORE_SIZE);
+         const auto stats = store.statistics();
+
+         std::cout << "entries:  " << stats.entries << '\n'
+                   << "bytes:    " << stats.bytes << '\n'
+                   << "capacity: " << stats.max_bytes << '\n';
+      } else if (command == "compact") {
+         const std::size_t max_bytes = argc == 4 ? std::stoull(argv[3]) : 0;
+         const auto res = compact_result_store(path, max_bytes);
+
+         std::cout << "entries: " << res.entries_before << " -> " << res.entries_after << '\n'
+                   << "bytes:   " << res.bytes_before << " -> " << res.bytes_after << '\n';
+      } else {
+         print_usage(argv[0]);
+         return EXIT_FAILURE;
+      }
+   } catch (const std::exception& e) {
+      std::cerr << "Error: " << e.what() << std::endl;
+      return EXIT_FAILURE;
+   }
+
+   return EXIT_SUCCESS;
+}
@@ -2,7 +2,9 @@ Needs["NumericalCalculus`"];
 
 (* load LibrayLink *)
 Get[FileNameJoin[{DirectoryName[$InputFileName], "..", "src", "LibraryLink.m"}]];
-TSILInitialize[libPath];
+(* double-precision variant, if it has been built *)
+libPathDouble = StringReplace[libPath, "LibraryLink." -> "LibraryLinkDouble."];
+TSILInitialize[libPath, If[FileExistsQ[libPathDouble], libPathDouble, None]];
 
 passedTests = 0;
 failedTests = 0;
@@ -108,6 +110,278 @@ PrintHeadline["Testing TSILEvaluate"];
 TestClose[sym /. TSILEvaluate[x, y, z, u, v, s, qq],
           sym /. results];
 
+With[{wanted = {Mxyzuv, Uzxyv, TBARvxu, Svyz, Ax, Izuv}},
+     TestEqual[First /@ TSILEvaluate[x, y, z, u, v, s, qq, wanted], wanted];
+     TestClose[wanted /. TSILEvaluate[x, y, z, u, v, s, qq, wanted],
+               wanted /. results, 1*^-14];
+];
+
+TestEqual[TSILEvaluate[x, y, z, u, v, s, qq, {}], {}];
+
+TestEqual[First /@ TSILEvaluate[x, y, z, u, v, s, qq], TSILResultNames];
+
+arr = TSILEvaluate[x, y, z, u, v, s, qq, "OutputFormat" -> "Real64"];
+
+TestEqual[Developer`PackedArrayQ[arr, Complex], True];
+TestClose[arr, TSILResultNames /. results];
+TestClose[arr[[TSILResultIndex[Tvyz]]], Tvyz /. results];
+
+arr = TSILEvaluate[x, y, z, u, v, s, qq, "OutputFormat" -> "Real128"];
+
+TestEqual[Length[arr], Length[TSILResultNames]];
+TestEqual[Precision[arr] > MachinePrecision, True];
+TestClose[arr, TSILResultNames /. results];
+
+TestClose[TSILEvaluate[x, y, z, u, v, s, qq, {Ax, Ixyv}, "OutputFormat" -> "Real64"],
+          {Ax, Ixyv} /. results];
+
+If[FileExistsQ[libPathDouble],
+   PrintHeadline["Testing double-precision variant"];
+   Block[{$TSILPrecision = "Double"},
+         TestClose[sym /. TSILEvaluate[x, y, z, u, v, s, qq], sym /. results, 10^-10];
+         TestClose[TSILB[x, z, s, qq], Bxz /. results, 10^-10];
+         session = TSILSessionCreate[x, y, z, u, v, qq];
+   ];
+   (* the session keeps its variant *)
+   TestClose[sym /. TSILSessionEvaluate[session, s], sym /. results, 10^-10];
+   ClearAll[session];
+
+   PrintHeadline["Testing adaptive precision"];
+   (* s close to the threshold of B(x,z) is escalated *)
+   sthr = (Sqrt[x] + Sqrt[z])^2 + 10^-9;
+   resthr = TSILEvaluate[x, y, z, u, v, sthr, qq, "OutputFormat" -> "Real64"];
+   TSILResetEscalationStatistics[];
+   Block[{$TSILPrecision = "Adaptive"},
+         TestClose[sym /. TSILEvaluate[x, y, z, u, v, s, qq], sym /. results, 10^-10];
+         TestClose[TSILEvaluateBatch[{{x, y, z, u, v, s, qq}, {x, y, z, u, v, sthr, qq}}],
+                   {TSILResultNames /. results, resthr}, 10^-10];
+   ];
+   TestEqual[TSILEscalationStatistics[]["Points"], 3];
+   TestEqual[TSILEscalationStatistics[]["Escalated"], 1];
+];
+
+PrintHeadline["Testing TSILEvaluateBatch"];
+
+batch = TSILEvaluateBatch[{{x, y, z, u, v, s, qq}, {x, y, z, u, v, s, qq}}];
+
+TestEqual[Dimensions[batch], {2, Length[sym]}];
+TestEqual[Developer`PackedArrayQ[batch], True];
+
+TestClose[#, sym /. results]& /@ batch;
+
+TestEqual[TSILSetNumberOfThreads[3], 3];
+TestEqual[TSILGetNumberOfThreads[], 3];
+
+TestClose[#, sym /. results]& /@ TSILEvaluateBatch[Table[{x, y, z, u, v, s, qq}, {10}]];
+
+TSILSetNumberOfThreads[Automatic];
+
+PrintHeadline["Testing TSILSubmit"];
+
+chunks = {};
+task = TSILSubmit[Table[{x, y, z, u, v, s, qq}, {10}], "ChunkSize" -> 3,
+                  "ChunkFunction" -> (AppendTo[chunks, {##}]&)];
+
+TestEqual[Head[task], TSILTask];
+
+collected = TSILCollect[task];
+
+TestEqual[Dimensions[collected], {10, Length[sym]}];
+TestClose[#, sym /. results]& /@ collected;
+
+task = TSILSubmit[Table[{x, y, z, u, v, s, qq}, {4}], "ChunkSize" -> 2];
+
+polled = {};
+While[!(p = TSILPoll[task])["Finished"], AppendTo[polled, p["Results"]]; Pause[0.01]];
+AppendTo[polled, p["Results"]];
+
+TestEqual[Length[Join @@ polled], 4];
+TestEqual[Dimensions[TSILCollect[task]], {0, Length[sym]}];
+
+PrintHeadline["Testing TSILConnect"];
+
+socket = FileNameJoin[{$TemporaryDirectory, "test_tsil_mma.sock"}];
+serverPath = FileNameJoin[{DirectoryName[libPath], "tsil-mma-server"}];
+
+TestEqual[Quiet[TSILConnect[socket]], $Failed];
+TestEqual[$TSILServer, None];
+
+If[FileExistsQ[serverPath],
+   server = StartProcess[{serverPath, "--socket", socket, "--threads", "2"}];
+   While[!FileExistsQ[socket], Pause[0.1]];
+   TestEqual[TSILConnect[socket], $TSILServer];
+   remote = TSILEvaluateBatch[Table[{x, y, z, u, v, s, qq}, {10}]];
+   TestEqual[Dimensions[remote], {10, Length[sym]}];
+   TestClose[#, sym /. results]& /@ remote;
+   TSILDisconnect[];
+   TestEqual[$TSILServer, None];
+   KillProcess[server];
+  ];
+
+PrintHeadline["Testing TSILEvaluateSweep"];
+
+sweep = TSILEvaluateSweep[x, y, z, u, v, {s, 2 s, s, s + I}, qq];
+
+TestEqual[Dimensions[sweep], {4, Length[sym]}];
+TestEqual[Developer`PackedArrayQ[sweep], True];
+
+TestClose[sweep[[1]], TSILResultNames /. results];
+TestClose[sweep[[3]], TSILResultNames /. results];
+TestClose[sweep[[4]], TSILResultNames /. results];
+TestClose[sweep[[2]], TSILEvaluate[x, y, z, u, v, 2 s, qq, "OutputFormat" -> "Real64"]];
+
+PrintHeadline["Testing TSILRescale"];
+
+resNew = TSILEvaluate[x, y, z, u, v, s, 7 qq];
+
+TestClose[sym /. TSILRescale[x, y, z, u, v, s, qq, results, 7 qq], sym /. resNew, 10^-13];
+TestClose[TSILRescale[x, y, z, u, v, s, qq, TSILResultNames /. results, 7 qq],
+          TSILResultNames /. resNew, 10^-13];
+TestClose[{Tvyz, Ax} /. TSILRescale[x, y, z, u, v, s, qq, {Tvyz -> (Tvyz /. results), Ax -> (Ax /. results)}, 7 qq],
+          {Tvyz, Ax} /. resNew, 10^-13];
+TestClose[sym /. TSILRescale[x, y, z, u, v, s, qq, results, qq], sym /. results];
+
+PrintHeadline["Testing TSILFindPole"];
+
+pole = TSILFindPole[x, {{1/100, TSILB[x, y, p, qq]}, {1/1000, TSILS[x, y, z, p, qq]}, {1/100, TSILA[z, qq]}}, p];
+
+TestEqual[pole["Converged"], True];
+TestEqual[pole["Iterations"] === Length[pole["History"]], True];
+TestClose[pole["Pole"],
+          x + TSILB[x, y, Re[pole["Pole"]], qq]/100 + TSILS[x, y, z, Re[pole["Pole"]], qq]/1000 + TSILA[z, qq]/100];
+
+PrintHeadline["Testing TSILSession"];
+
+session = TSILSessionCreate[x, y, z, u, v, qq];
+
+TestEqual[Head[session], TSILSession];
+TestClose[sym /. TSILSessionEvaluate[session, s], sym /. results];
+TestClose[TSILSessionEvaluate[session, 2 s, {Ax, Tvyz}],
+          {Ax, Tvyz} /. TSILEvaluate[x, y, z, u, v, 2 s, qq]];
+TestClose[{Mxyzuv, Izuv} /. TSILSessionEvaluate[session, s, {Mxyzuv, Izuv}],
+          {Mxyzuv, Izuv} /. results];
+
+ClearAll[session];
+
+PrintHeadline["Testing TSILEvaluateMany"];
+
+TSILClearCache[];
+
+TestClose[
+    TSILEvaluateMany[{
+        TSILU[z, x, y, v, s, qq], TSILU[u, y, x, v, s, qq],
+        TSILU[x, z, u, v, s, qq], TSILU[y, u, z, v, s, qq],
+        TSILV[z, x, v, y, s, qq], TSILT[v, z, y, s, qq],
+        TSILTbar[x, v, u, s, qq], TSILS[v, u, x, s, qq],
+        TSILM[y, x, u, z, v, s], TSILB[x, z, s, qq],
+        TSILA[v, qq], TSILI[x, y, v, qq]
+    }],
+    {Uzxyv, Uuyxv, Uxzuv, Uyuzv, Vzxyv, Tvyz, TBARxuv, Suxv, Mxyzuv, Bxz, Av, Ixyv} /. results,
+    1*^-14];
+
+TestClose[
+    TSILEvaluateMany[Hold[{TSILT[v, y, z, s, qq], TSILT[y, z, v, s, qq], TSILT[v, y, z, s, qq]}]],
+    {Tvyz, Tyzv, Tvyz} /. results];
+
+TestEqual[Quiet[TSILEvaluateMany[{TSILT[v, y, z, s]}]], $Failed];
+
+PrintHeadline["Testing result cache"];
+
+TSILClearCache[];
+
+TestClose[TSILI[x, y, v, qq], Ixyv /. results];
+TestClose[TSILI[v, x, y, qq], Ixyv /. results];
+TestClose[TSILU[z, x, v, y, s, qq], Uzxyv /. results, 1*^-14];
+TestClose[TSILM[y, x, u, z, v, s], Mxyzuv /. results];
+TestClose[TSILM[z, u, x, y, v, s], Mxyzuv /. results];
+
+TestEqual[TSILCacheStatistics[]["Misses"], 3];
+TestEqual[TSILCacheStatistics[]["Hits"], 2];
+
+TSILSetCacheSize[0];
+TSILI[x, y, v, qq];
+TestEqual[TSILCacheStatistics[]["Entries"], 0];
+TSILSetCacheSize[64 1024^2];
+
+TSILClearCache[];
+TestEqual[TSILSetCacheNormalization[True], True];
+TSILEvaluate[x, y, z, u, v, s, qq];
+resScaled = TSILEvaluate[8 x, 8 y, 8 z, 8 u, 8 v, 8 s, 3 qq];
+TestEqual[TSILCacheStatistics[]["RescaledHits"], 1];
+TSILSetCacheNormalization[False];
+TSILClearCache[];
+TestClose[sym /. resScaled, sym /. TSILEvaluate[8 x, 8 y, 8 z, 8 u, 8 v, 8 s, 3 qq], 10^-12];
+TSILSetCacheNormalization[True];
+TSILT[v, y, z, s, qq];
+TSILT[2 v, 2 y, 2 z, 2 s, qq];
+TestEqual[TSILCacheStatistics[]["RescaledHits"], 1];
+TSILSetCacheNormalization[False];
+
+PrintHeadline["Testing TSILStatistics"];
+
+TSILClearCache[];
+TSILResetStatistics[];
+
+TSILB[x, y, s, qq];
+TSILB[y, x, s, qq];
+TSILT[v, y, z, s, qq];
+
+stats = TSILStatistics[];
+
+TestEqual[Sort[Keys[stats]], {"B", "T"}];
+TestEqual[stats["B"]["Calls"], 2];
+TestEqual[stats["B"]["CacheHits"], 1];
+TestEqual[stats["B"]["FallbackRate"], 0];
+TestEqual[stats["T"]["Analytic"] + stats["T"]["ODE"], 1];
+
+TSILResetStatistics[];
+TestEqual[TSILStatistics[], <||>];
+
+PrintHeadline["Testing TSILSetResultStore"];
+
+storeFile = FileNameJoin[{$TemporaryDirectory, "test_result_store.bin"}];
+Quiet[DeleteFile[storeFile]];
+
+TSILSetResultStore[storeFile, 2^22];
+TSILClearCache[];
+stored = TSILEvaluate[x, y, z, u, v, s, qq];
+TestEqual[TSILResultStoreStatistics[]["Entries"], 1];
+
+(* a new kernel starts with an empty cache *)
+TSILClearCache[];
+TestEqual[TSILEvaluate[x, y, z, u, v, s, qq], stored];
+TestEqual[TSILResultStoreStatistics[]["Hits"], 1];
+
+TSILSetResultStore[None];
+TestEqual[TSILResultStoreStatistics[]["Entries"], 0];
+DeleteFile[storeFile];
+
+PrintHeadline["Testing TSILTraceStatistics"];
+
+TSILResetTracing[];
+TSILEvaluate[x, y, z, u, v, s, qq];
+
+trace = TSILTraceStatistics[];
+
+TestEqual[AssociationQ[trace], True];
+
+If[trace["enabled"],
+   TestEqual[trace["functions"]["TSILEvaluate"]["compute"]["count"], 1];
+   TestEqual[trace["functions"]["TSILEvaluate"]["marshal"]["count"], 1];
+   TSILResetTracing[];
+   TestEqual[TSILTraceStatistics[]["functions"], <||>],
+   TestEqual[trace["functions"], <||>]
+];
+
+PrintHeadline["Testing native library functions"];
+
+(* machine numbers are passed as native arguments, others via LinkObject *)
+TestEqual[MachineNumberQ[TSILB[x, z, s, qq]], True];
+TestClose[TSILB[x, z, s, qq], TSILB[N[x, 20], N[z, 20], N[s, 20], N[qq, 20]]];
+TestClose[TSILI[x, y, v, qq], TSILI[N[x, 20], N[y, 20], N[v, 20], N[qq, 20]]];
+TestClose[TSILT[v, y, z, s, qq], TSILT[N[v, 20], N[y, 20], N[z, 20], N[s, 20], N[qq, 20]]];
+TestClose[TSILB[x, z, s + I, qq], TSILB[N[x, 20], N[z, 20], N[s + I, 20], N[qq, 20]]];
+
 PrintHeadline["Testing TSILA"];
 
 TestClose[Ax /. results,
@@ -0,0 +1,210 @@
+// ====================================================================
+// This file is part of tsil-mma.
+//
+// tsil-mma is licenced under the GNU General Public License (GNU GPL)
+// version 3.
+// ====================================================================
+
+// Tests of the tsil-mma-batch program, whose path is passed as the
+// first argument.
+
+#include "tsil_mma.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+int passed_tests = 0;
+int failed_tests = 0;
+
+void test_close(const std::string& name, double a, double b, double eps)
+{
+   const double diff = std::abs(a - b);
+
+   if (diff < eps || (std::abs(a) > eps && diff/std::abs(a) < eps)) {
+      passed_tests++;
+   } else {
+      std::cout << "Test failed: " << name << ": " << a << " !~ " << b
+                << " within " << eps << std::endl;
+      failed_tests++;
+   }
+}
+
+void test_equal(const std::string& name, bool ok)
+{
+   if (ok) {
+      passed_tests++;
+   } else {
+      std::cout << "Test failed: " << name << std::endl;
+      failed_tests++;
+   }
+}
+
+using namespace tsil_mma;
+
+const double eps = 1e-15;
+
+/// points {x, y, z, u, v, Re(s), Im(s), qq}
+const std::vector<Parameters> points{
+   {1, 2, 3, 4, 5, 10, 0, 1},
+   {1, 2, 3, 4, 5, 20, 0, 1},
+   {2, 0, 3, 1, 5, 7, 0, 2},
+};
+
+std::string program;
+
+/// runs tsil-mma-batch with the given arguments, returns the exit status
+int run_batch(const std::string& args)
+{
+   const std::string command = '"' + program + "\" " + args + " 2> test_batch.log";
+   return std::system(command.c_str());
+}
+
+/// compares a row of 64 doubles {Re, Im, ...} with calculate_results()
+void test_row(const std::string& name, const std::vector<double>& row, const Parameters& point)
+{
+   const auto expected = calculate_results(point);
+   const auto& names = result_names();
+
+   test_equal(name + " row size", row.size() == 2*NUMBER_OF_RESULTS);
+
+   if (row.size() != 2*NUMBER_OF_RESULTS) {
+      return;
+   }
+
+   for (int k = 0; k < NUMBER_OF_RESULTS; k++) {
+      test_close(name + " Re(" + names[k] + ")", row[2*k], static_cast<double>(std::real(expected[k])), eps);
+      test_close(name + " Im(" + names[k] + ")", row[2*k + 1], static_cast<double>(std::imag(expected[k])), eps);
+   }
+}
+
+void test_csv()
+{
+   {
+      std::ofstream in("test_batch_input.csv");
+      in << "# x, y, z, u, v, Re(s), Im(s), qq\n";
+      for (const auto& p: points) {
+         for (int k = 0; k < NUMBER_OF_PARAMETERS; k++) {
+            in << (k ? ", " : "") << static_cast<double>(p[k]);
+         }
+         in << "\n\n";
+      }
+   }
+
+   test_equal("csv exit status",
+              run_batch("--threads 2 --chunk-size 2 test_batch_input.csv test_batch_output.csv") == 0);
+
+   std::ifstream out("test_batch_output.csv");
+   std::string line;
+
+   std::getline(out, line);
+   const std::string header = "Re(" + result_names()[0] + "),Im(" + result_names()[0] + "),";
+   test_equal("csv header", line.compare(0, header.size(), header) == 0);
+
+   std::size_t n_rows = 0;
+
+   while (std::getline(out, line) && n_rows < points.size()) {
+      std::vector<double> row;
+      std::istringstream fields(line);
+      std::string field;
+      while (std::getline(fields, field, ',')) {
+         row.push_back(std::stod(field));
+      }
+      test_row("csv point " + std::to_string(n_rows + 1), row, points[n_rows]);
+      n_rows++;
+   }
+
+   test_equal("csv number of rows", n_rows == points.size() && !std::getline(out, line));
+
+   std::remove("test_batch_input.csv");
+   std::remove("test_batch_output.csv");
+}
+
+void test_binary()
+{
+   {
+      std::ofstream in("test_batch_input.bin", std::ios::binary);
+      for (const auto& p: points) {
+         for (int k = 0; k < NUMBER_OF_PARAMETERS; k++) {
+            const double d = static_cast<double>(p[k]);
+            in.write(reinterpret_cast<const char*>(&d), sizeof(d));
+         }
+      }
+   }
+
+   test_equal("binary exit status",
+              run_batch("--chunk-size 2 test_batch_input.bin test_batch_output.bin") == 0);
+
+   std::ifstream out("test_batch_output.bin", std::ios::binary);
+
+   for (std::size_t i = 0; i < points.size(); i++) {
+      std::vector<double> row(2*NUMBER_OF_RESULTS);
+      out.read(reinterpret_cast<char*>(row.data()), row.size()*sizeof(double));
+      test_equal("binary read row " + std::to_string(i + 1), static_cast<bool>(out));
+      test_row("binary point " + std::to_string(i + 1), row, points[i]);
+   }
+
+   test_equal("binary end of output", out.get() == std::char_traits<char>::eof());
+
+   std::remove("test_batch_input.bin");
+   std::remove("test_batch_output.bin");
+}
+
+void test_errors()
+{
+   {
+      std::ofstream in("test_batch_input.csv");
+      in << "1, 2, 3, 4, 5, 10, 0, 1\n"
+         << "1, 2, 3, 4, 5, 10, 0\n";
+   }
+
+   test_equal("invalid line", run_batch("test_batch_input.csv test_batch_output.csv") != 0);
+
+   std::ifstream log("test_batch.log");
+   const std::string msg((std::istreambuf_iterator<char>(log)), std::istreambuf_iterator<char>());
+
+   test_equal("invalid line message", msg.find("Line 2:") != std::string::npos);
+
+   {
+      std::ofstream in("test_batch_input.bin", std::ios::binary);
+      const double d = 1;
+      in.write(reinterpret_cast<const char*>(&d), sizeof(d));
+   }
+
+   test_equal("truncated binary input", run_batch("test_batch_input.bin test_batch_output.bin") != 0);
+
+   std::remove("test_batch_input.csv");
+   std::remove("test_batch_output.csv");
+   std::remove("test_batch_input.bin");
+   std::remove("test_batch_output.bin");
+   std::remove("test_batch.log");
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[])
+{
+   if (argc != 2) {
+      std::cerr << "Usage: " << argv[0] << " <path to tsil-mma-batch>" << std::endl;
+      return EXIT_FAILURE;
+   }
+
+   program = argv[1];
+
+   test_csv();
+   test_binary();
+   test_errors();
+
+   std::cout << "Passed tests: " << passed_tests << std::endl;
+   std::cout << "Failed tests: " << failed_tests << std::endl;
+
+   return failed_tests == 0 ? 0 : 1;
+}
@@ -0,0 +1,697 @@
+// ====================================================================
+// This file is part of tsil-mma.
+//
+// tsil-mma is licenced under the GNU General Public License (GNU GPL)
+// version 3.
+// ====================================================================
+
+// Tests of the tsil-mma core library, which do not need Mathematica.
+
+#include "tsil_mma.h"
+#include "protocol.h"
+#include "result_store.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+int passed_tests = 0;
+int failed_tests = 0;
+
+template <class T>
+void test_close(const std::string& name, std::complex<T> a, std::complex<T> b, T eps)
+{
+   const T diff = std::abs(a - b);
+
+   if (diff < eps || (std::abs(a) > eps && diff/std::abs(a) < eps)) {
+      passed_tests++;
+   } else {
+      std::cout << "Test failed: " << name << ": " << a << " !~ " << b
+                << " within " << eps << std::endl;
+      failed_tests++;
+   }
+}
+
+void test_equal(const std::string& name, bool ok)
+{
+   if (ok) {
+      passed_tests++;
+   } else {
+      std::cout << "Test failed: " << name << std::endl;
+      failed_tests++;
+   }
+}
+
+using namespace tsil_mma;
+
+const TSIL_REAL x  = 1;
+const TSIL_REAL y  = 2;
+const TSIL_REAL z  = 3;
+const TSIL_REAL u  = 4;
+const TSIL_REAL v  = 5;
+const TSIL_REAL s  = 10;
+const TSIL_REAL qq = 1;
+
+// the reference values have been obtained in long double precision
+const TSIL_REAL eps = sizeof(TSIL_REAL) > sizeof(double) ? 1e-14L : 1e-10L;
+
+/// obtained by ./tsil 1 2 3 4 5 10 1
+const std::vector<std::pair<std::string, TSIL_COMPLEXCPP>>& reference()
+{
+   static const std::vector<std::pair<std::string, TSIL_COMPLEXCPP>> ref{
+      {"Mxyzuv", {0.7183353535335331L, 0.3901621999727627L}},
+      {"Uzxyv", {-3.9926362044407706L, -1.7995145055126969L}},
+      {"Uuyxv", {-2.2323589397530124L, -0.0000000000000002L}},
+      {"Uxzuv", {-4.8569530649079544L, -2.1275603386772164L}},
+      {"Uyuzv", {-3.0864179723725735L, -0.0000000000000003L}},
+      {"Tvyz", {0.4467752422961078L, 0.0000000000000001L}},
+      {"Tuxv", {-0.0303601769384458L, 0.0000000000000002L}},
+      {"Tyzv", {-1.6945169297078884L, 0.0000000000000008L}},
+      {"Txuv", {-3.0122117237897288L, 0.0000000000000003L}},
+      {"Tzyv", {-0.7861278798773168L, -0.0000000000000005L}},
+      {"Tvxu", {0.5159165810473397L, -0.0000000000000003L}},
+      {"Svyz", {-7.6704797871895378L, 0.0000000000000014L}},
+      {"Suxv", {-9.5666067888028632L, 0.0000000000000003L}},
+      {"Bxz", {0.7793038407369921L, 1.5390597961942369L}},
+      {"Byu", {-0.0515132849728505L, -0.0000000000000000L}},
+      {"Vzxyv", {0.1961860092807476L, -0.9808434544663881L}},
+      {"Vuyxv", {-0.7859205937573606L, 0.0000000000000012L}},
+      {"Vxzuv", {0.0181520588278395L, -0.7752579663009971L}},
+      {"Vyuzv", {-0.7543085167460677L, 0.0000000000000006L}},
+      {"TBARvyz", {2.1585311655792454L, 0.5056198322111863L}},
+      {"TBARuxv", {0.4379362305548289L, 0.0000000000000002L}},
+      {"TBARyzv", {-2.2324104469869441L, 0.0000000000000008L}},
+      {"TBARxuv", {-3.0122117237897288L, 0.0000000000000003L}},
+      {"TBARzyv", {-1.2678544111018766L, -0.0000000000000005L}},
+      {"TBARvxu", {1.9498686438515711L, 1.5168594966335585L}},
+      {"Ixyv", {-2.4330986130738634L, 0.0000000000000000L}},
+      {"Izuv", {5.1155528299660125L, 0.0000000000000000L}},
+      {"Ax", {-1.0000000000000000L, 0.0000000000000000L}},
+      {"Ay", {-0.6137056388801094L, 0.0000000000000000L}},
+      {"Az", {0.2958368660043291L, 0.0000000000000000L}},
+      {"Au", {1.5451774444795625L, 0.0000000000000000L}},
+      {"Av", {3.0471895621705021L, 0.0000000000000000L}},
+   };
+   return ref;
+}
+
+TSIL_COMPLEXCPP reference(const std::string& name)
+{
+   for (const auto& r: reference()) {
+      if (r.first == name) {
+         return r.second;
+      }
+   }
+   return {};
+}
+
+void test_results()
+{
+   const Parameters pars{x, y, z, u, v, s, 0, qq};
+   const auto results = calculate_results(pars);
+   const auto& names = result_names();
+
+   for (int k = 0; k < NUMBER_OF_RESULTS; k++) {
+      test_close(names[k], results[k], reference(names[k]), eps);
+   }
+}
+
+void test_batch()
+{
+   const Parameters pars{x, y, z, u, v, s, 0, qq};
+   std::vector<std::string> messages;
+
+   set_number_of_threads(3);
+   clear_cache();
+
+   const auto results = calculate_results(std::vector<Parameters>(10, pars), &messages);
+
+   test_equal("batch size", results.size() == 10 && messages.size() == 10);
+
+   for (const auto& res: results) {
+      for (int k = 0; k < NUMBER_OF_RESULTS; k++) {
+         test_close(result_names()[k], res[k], reference(result_names()[k]), eps);
+      }
+   }
+
+   set_number_of_threads(0);
+}
+
+void test_thread_pool()
+{
+   Thread_pool pool(4);
+   std::atomic<bool> second_started{false};
+   std::atomic<bool> overlapped{false};
+   std::atomic<int> calls{0};
+
+   // the first call waits until the second one runs concurrently
+   std::thread first([&] {
+      pool.parallel_for(8, [&] (std::size_t, std::size_t) {
+         const auto start = std::chrono::steady_clock::now();
+         while (!second_started.load() &&
+                std::chrono::steady_clock::now() - start < std::chrono::seconds(5)) {
+            std::this_thread::yield();
+         }
+         overlapped.store(overlapped.load() || second_started.load());
+         calls++;
+      });
+   });
+
+   pool.parallel_for(8, [&] (std::size_t, std::size_t) {
+      second_started.store(true);
+      calls++;
+   });
+
+   first.join();
+
+   test_equal("concurrent parallel_for", overlapped.load() && calls.load() == 16);
+
+   // nested calls use distinct worker indices within each call
+   std::vector<std::vector<int>> counts(4, std::vector<int>(pool.size(), 0));
+   std::atomic<bool> distinct{true};
+
+   pool.parallel_for(4, [&] (std::size_t, std::size_t i) {
+      std::vector<std::atomic<int>> busy(pool.size());
+      pool.parallel_for(20, [&] (std::size_t worker, std::size_t) {
+         if (busy[worker]++ != 0) {
+            distinct.store(false);
+         }
+         counts[i][worker]++;
+         busy[worker]--;
+      });
+   });
+
+   int total = 0;
+   for (const auto& c: counts) {
+      for (const auto k: c) {
+         total += k;
+      }
+   }
+
+   test_equal("nested parallel_for", distinct.load() && total == 80);
+
+   // the workers stay within the count passed to setup while the pool
+   // is resized concurrently
+   std::atomic<bool> in_range{true};
+   std::atomic<bool> resizing{true};
+
+   std::thread resizer([&] {
+      for (std::size_t n = 1; n <= 16; n++) {
+         pool.resize(n);
+      }
+      resizing.store(false);
+   });
+
+   while (resizing.load()) {
+      std::vector<int> per_worker;
+      pool.parallel_for(32, [&] (std::size_t n_workers) { per_worker.assign(n_workers, 0); },
+                        [&] (std::size_t worker, std::size_t) {
+         if (worker >= per_worker.size()) {
+            in_range.store(false);
+         }
+      });
+   }
+
+   resizer.join();
+
+   test_equal("parallel_for setup", in_range.load() && pool.size() == 16);
+}
+
+void test_chunks()
+{
+   std::vector<Parameters> points;
+
+   for (int i = 0; i < 20; i++) {
+      points.push_back({x, y, z, u, v, s + i, 0, qq});
+   }
+
+   set_number_of_threads(2);
+   clear_cache();
+
+   std::vector<Results> results;
+   int calls = 0;
+
+   // abort after the first chunk, which has one point per thread
+   const auto done = calculate_results_in_chunks(points, results, [&calls] { return ++calls > 0; });
+
+   test_equal("aborted chunks", done == 2 && calls == 1);
+   test_equal("partial results", results[1] == calculate_results(points[1]));
+
+   const auto all = calculate_results_in_chunks(points, results, [] { return false; });
+
+   test_equal("all chunks", all == points.size());
+   test_equal("chunked results", results.back() == calculate_results(points.back()));
+
+   // more threads in every chunk
+   clear_cache();
+   std::size_t n_threads = 2;
+   const auto grown = calculate_results_in_chunks(points, results, [&n_threads] {
+      set_number_of_threads(++n_threads);
+      return false;
+   });
+
+   test_equal("chunks with growing pool", grown == points.size() && n_threads > 3);
+   clear_cache();
+   test_equal("results with growing pool", results == calculate_results(points));
+
+   set_number_of_threads(0);
+}
+
+void test_sweep()
+{
+   const Parameters pars{x, y, z, u, v, s, 0, qq};
+   const std::vector<TSIL_COMPLEXCPP> svals{2*s, s, 3*s, s, TSIL_COMPLEXCPP(s, 1)};
+   std::vector<std::string> messages;
+
+   set_number_of_threads(2);
+   clear_cache();
+
+   const auto results = calculate_sweep(pars, svals, &messages);
+
+   test_equal("sweep size", results.size() == svals.size() && messages.size() == svals.size());
+
+   for (std::size_t i = 0; i < svals.size(); i++) {
+      auto point = pars;
+      point[5] = std::real(svals[i]);
+      const auto expected = calculate_results(point);
+
+      for (int k = 0; k < NUMBER_OF_RESULTS; k++) {
+         test_close(result_names()[k], results[i][k], expected[k], eps);
+      }
+   }
+
+   for (int k = 0; k < NUMBER_OF_RESULTS; k++) {
+      test_close(result_names()[k], results[1][k], reference(result_names()[k]), eps);
+   }
+
+   set_number_of_threads(0);
+}
+
+void test_session()
+{
+   clear_cache();
+
+   Session session(x, y, z, u, v, qq);
+
+   const auto results = session.evaluate(s);
+
+   for (int k = 0; k < NUMBER_OF_RESULTS; k++) {
+      test_close(result_names()[k], results[k], reference(result_names()[k]), eps);
+   }
+
+   const auto values = session.evaluate(2*s, {"Tvyz", "Ax"});
+   const auto expected = calculate_results(Parameters{x, y, z, u, v, 2*s, 0, qq}, {"Tvyz", "Ax"});
+
+   test_equal("number of session results", values.size() == 2);
+   test_close("Tvyz", values.at(0), expected.at(0), eps);
+   test_close("Ax", values.at(1), expected.at(1), eps);
+}
+
+void test_find_pole()
+{
+   const TSIL_COMPLEXCPP m2 = x;
+   const std::vector<Pole_term> terms{
+      {TSIL_COMPLEXCPP(0.01L), {Function::B, {x, y, 0, 0, qq}}},
+      {TSIL_COMPLEXCPP(0.001L), {Function::S, {x, y, z, 0, 0, qq}}},
+      {TSIL_COMPLEXCPP(0.01L), {Function::A, {z, qq}}},
+   };
+
+   const auto result = find_pole(m2, terms);
+
+   test_equal("pole converged", result.converged);
+   test_equal("pole iterations", !result.iterations.empty());
+
+   const TSIL_REAL rs = std::real(result.s);
+   const auto expected = m2
+      + TSIL_COMPLEXCPP(0.01L)*calculate_integral({Function::B, {x, y, rs, 0, qq}})
+      + TSIL_COMPLEXCPP(0.001L)*calculate_integral({Function::S, {x, y, z, rs, 0, qq}})
+      + TSIL_COMPLEXCPP(0.01L)*calculate_integral({Function::A, {z, qq}});
+
+   test_close("pole", result.s, expected, TSIL_REAL(1e-10L));
+}
+
+void test_error_estimate()
+{
+   const Parameters pars{x, y, z, u, v, s, 0, qq};
+   const auto results = calculate_results(pars);
+   const auto error = estimate_error(pars, results);
+
+   test_equal("estimate_error (generic)", error > 0 && error < eps);
+
+   // s close to the threshold of B(x,z)
+   auto thr = pars;
+   thr[5] = std::pow(std::sqrt(x) + std::sqrt(z), 2) + TSIL_REAL(1e-8L);
+   test_equal("estimate_error (threshold)", estimate_error(thr, calculate_results(thr)) > 1e6*error);
+
+   // large mass hierarchy
+   auto hier = pars;
+   hier[0] = TSIL_REAL(1e-8L);
+   test_equal("estimate_error (hierarchy)", estimate_error(hier, calculate_results(hier)) > 1e6*error);
+
+   // a result that deviates from its analytic value
+   const auto& names = result_names();
+   const auto bxz = std::find(names.begin(), names.end(), "Bxz") - names.begin();
+   auto wrong = results;
+   wrong[bxz] *= TSIL_REAL(1 + 1e-6L);
+   test_equal("estimate_error (deviation)", estimate_error(pars, wrong) >= TSIL_REAL(1e-7L));
+
+   auto nan = results;
+   nan[0] = TSIL_COMPLEXCPP(std::nan(""), 0);
+   test_equal("estimate_error (non-finite)", std::isinf(estimate_error(pars, nan)));
+}
+
+void test_rescale()
+{
+   const TSIL_REAL qq_new = 7;
+   const Parameters pars{x, y, z, u, v, s, 0, qq};
+   const Parameters pars_new{x, y, z, u, v, s, 0, qq_new};
+   const auto rescaled = rescale_results(pars, calculate_results(pars), qq_new);
+   const auto expected = calculate_results(pars_new);
+   const auto& names = result_names();
+
+   for (int k = 0; k < NUMBER_OF_RESULTS; k++) {
+      test_close("rescaled " + names[k], rescaled[k], expected[k], 10*eps);
+   }
+
+   test_close("rescaled Ip2",
+              rescale_integral({Function::Ip2, {x, y, z, qq}},
+                               calculate_integral({Function::Ip2, {x, y, z, qq}}), qq_new),
+              calculate_integral({Function::Ip2, {x, y, z, qq_new}}), eps);
+
+   test_close("rescaled Beps",
+              rescale_integral({Function::Beps, {x, y, s, 0, qq}},
+                               calculate_integral({Function::Beps, {x, y, s, 0, qq}}), qq_new),
+              calculate_integral({Function::Beps, {x, y, s, 0, qq_new}}), eps);
+}
+
+void test_selected_results()
+{
+   const Parameters pars{x, y, z, u, v, s, 0, qq};
+   const std::vector<std::string> names{"Mxyzuv", "TBARvxu", "Svyz", "Ax", "Izuv"};
+   const auto values = calculate_results(pars, names);
+
+   test_equal("number of selected results", values.size() == names.size());
+
+   for (std::size_t k = 0; k < names.size(); k++) {
+      test_close(names[k], values[k], reference(names[k]), eps);
+   }
+
+   // evaluated at Re(s), as all results
+   const auto complex_s = calculate_results({x, y, z, u, v, s, 2, qq}, {"Bxz", "Svyz"});
+   test_close("Bxz (Im(s) != 0)", complex_s[0], reference("Bxz"), eps);
+   test_close("Svyz (Im(s) != 0)", complex_s[1], reference("Svyz"), eps);
+}
+
+void test_integrals()
+{
+   clear_cache();
+
+   const std::vector<Integral> integrals{
+      {Function::U, {z, x, y, v, s, 0, qq}},
+      {Function::V, {z, x, v, y, s, 0, qq}},
+      {Function::T, {v, z, y, s, 0, qq}},
+      {Function::Tbar, {x, v, u, s, 0, qq}},
+      {Function::S, {v, u, x, s, 0, qq}},
+      {Function::M, {y, x, u, z, v, s, 0}},
+      {Function::B, {x, z, s, 0, qq}},
+      {Function::A, {v, qq}},
+      {Function::I, {x, y, v, qq}}
+   };
+   const std::vector<std::string> names{
+      "Uzxyv", "Vzxyv", "Tvyz", "TBARxuv", "Suxv", "Mxyzuv", "Bxz", "Av", "Ixyv"
+   };
+
+   const auto values = calculate_integrals(integrals);
+
+   for (std::size_t k = 0; k < names.size(); k++) {
+      test_close(names[k], values[k], reference(names[k]), eps);
+   }
+
+   test_close("TSIL_Tanalytic_", calculate_integral({Function::T, {v, y, z, s, 0, qq}}),
+              reference("Tvyz"), eps);
+
+   const auto stats = get_cache_statistics();
+   test_equal("cache hit", stats.hits == 1);
+}
+
+void test_cache_normalization()
+{
+   const Parameters pars{x, y, z, u, v, s, 0, qq};
+   const TSIL_REAL k = 8;
+   const Parameters scaled{k*x, k*y, k*z, k*u, k*v, k*s, 0, 3*qq};
+
+   set_cache_normalization(true);
+   clear_cache();
+
+   calculate_results(pars);
+   const auto rescaled = calculate_results(scaled);
+   test_equal("rescaled hits (results)", get_cache_statistics().rescaled_hits == 1);
+
+   calculate_integral({Function::T, {v, y, z, s, 0, qq}});
+   const auto t = calculate_integral({Function::T, {k*v, k*y, k*z, k*s, 0, 3*qq}});
+   test_equal("rescaled hits (integral)", get_cache_statistics().rescaled_hits == 2);
+
+   set_cache_normalization(false);
+   clear_cache();
+
+   const auto expected = calculate_results(scaled);
+   const auto& names = result_names();
+
+   for (int i = 0; i < NUMBER_OF_RESULTS; i++) {
+      test_close("normalized " + names[i], rescaled[i], expected[i], 100*eps);
+   }
+
+   test_close("normalized T", t, calculate_integral({Function::T, {k*v, k*y, k*z, k*s, 0, 3*qq}}), 100*eps);
+
+   // the results are evaluated at Re(s), also if Im(s) != 0
+   const TSIL_REAL is = 2;
+
+   set_cache_normalization(true);
+   clear_cache();
+
+   const auto complex_s = calculate_results({x, y, z, u, v, s, is, qq});
+   const auto complex_s_rescaled = calculate_results({k*x, k*y, k*z, k*u, k*v, k*s, k*is, 3*qq});
+   test_equal("rescaled hits (Im(s) != 0)", get_cache_statistics().rescaled_hits == 1);
+
+   set_cache_normalization(false);
+   clear_cache();
+
+   const auto expected_real_s = calculate_results(pars);
+
+   for (int i = 0; i < NUMBER_OF_RESULTS; i++) {
+      test_close("normalized (Im(s) != 0) " + names[i], complex_s[i], expected_real_s[i], 100*eps);
+      test_close("normalized rescaled (Im(s) != 0) " + names[i], complex_s_rescaled[i], expected[i], 100*eps);
+   }
+}
+
+void test_non_finite_keys()
+{
+   const TSIL_REAL nan = std::numeric_limits<TSIL_REAL>::quiet_NaN();
+
+   clear_cache();
+
+   for (int i = 0; i < 3; i++) {
+      try {
+         calculate_integral({Function::A, {nan, qq}});
+         calculate_results(Parameters{x, y, z, u, v, nan, 0, qq});
+      } catch (const std::exception&) {
+      }
+   }
+
+   test_equal("non-finite keys not cached", get_cache_statistics().entries == 0);
+}
+
+void test_function_statistics()
+{
+   const auto index = [] (Function f) { return static_cast<int>(f); };
+
+   test_equal("function_name", function_name(Function::Tbar) == "Tbar");
+   test_equal("function_from_name", function_from_name(function_name(Function::V)) == Function::V);
+
+   clear_cache();
+   reset_function_statistics();
+
+   calculate_integral({Function::B, {x, y, s, 0, qq}});
+   calculate_integral({Function::B, {y, x, s, 0, qq}});
+   calculate_integral({Function::U, {x, y, z, u, s, 0, qq}});
+   calculate_results(Parameters{x, y, z, u, v, s, 0, qq});
+
+   const auto stats = get_function_statistics();
+   const auto& b = stats[index(Function::B)];
+   const auto& uu = stats[index(Function::U)];
+   const auto& ev = stats[index(Function::Evaluate)];
+
+   test_equal("B calls", b.calls == 2 && b.cache_hits == 1 && b.analytic == 1 && b.ode == 0);
+   test_equal("U calls", uu.calls == 1 && uu.analytic + uu.ode == 1);
+   test_equal("U time", uu.ode == 0 || uu.ode_seconds > 0);
+   test_equal("Evaluate calls", ev.calls == 1 && ev.ode == 1 && ev.ode_seconds > 0);
+
+   reset_function_statistics();
+   test_equal("reset statistics", get_function_statistics()[index(Function::B)].calls == 0);
+}
+
+void test_result_store()
+{
+   const std::string path = "test_result_store.bin";
+   const Parameters pars{x, y, z, u, v, s, 0, qq};
+   const std::size_t capacity = 4*1024*1024;
+
+   std::remove(path.c_str());
+   set_result_store(path, capacity);
+   clear_cache();
+
+   const auto expected = calculate_results(pars);
+   calculate_integral({Function::T, {v, y, z, s, 0, qq}});
+   test_equal("store entries", get_store_statistics().entries == 2);
+
+   // a new session starts with an empty cache
+   clear_cache();
+
+   const auto stored = calculate_results(pars);
+   test_equal("store hit", get_store_statistics().hits == 1);
+   test_equal("stored results", stored == expected);
+
+   {
+      // another process on the same file
+      Result_store other(path, capacity);
+      test_equal("shared entries", other.statistics().entries == 2);
+
+      const auto res = compact_result_store(path, capacity/2);
+      test_equal("compacted entries", res.entries_before == 2 && res.entries_after == 2);
+
+      Result_store::Key key;
+      Result_store::Origin origin;
+      std::vector<TSIL_COMPLEXCPP> values;
+
+      Result_store::make_key(static_cast<int>(Function::Evaluate), pars.data(), pars.size(), key);
+      test_equal("get after compaction", other.get(key, values, origin) && values.size() == NUMBER_OF_RESULTS
+                 && values.front() == expected.front());
+      test_equal("capacity after compaction", other.statistics().max_bytes == capacity/2);
+   }
+
+   set_result_store("");
+   test_equal("closed store", get_store_statistics().entries == 0);
+   std::remove(path.c_str());
+}
+
+void test_protocol()
+{
+   const std::string path = "test_protocol.sock";
+   const double point[NUMBER_OF_PARAMETERS] = {
+      double(x), double(y), double(z), double(u), double(v), double(s), 0, double(qq)};
+
+   const int listener = listen_on_socket(path);
+
+   bool closed = false;
+
+   // answers the first request with diagnostic output and the point
+   // and the second one with an error
+   std::thread server([listener, &closed] {
+      const int fd = accept(listener, nullptr, nullptr);
+      Message_header header;
+      std::vector<double> in(NUMBER_OF_PARAMETERS);
+
+      read_header(fd, header);
+      read_exact(fd, in.data(), in.size()*sizeof(double));
+      std::vector<double> out(NUMBER_OF_RESULTS*2, in[5]);
+      write_diagnostics(fd, {"warning\n"});
+      write_message(fd, Message_type::Results, 1, out.data(), out.size()*sizeof(double));
+
+      read_header(fd, header);
+      read_exact(fd, in.data(), in.size()*sizeof(double));
+      const std::string msg("invalid point");
+      write_message(fd, Message_type::Error, msg.size(), msg.data(), msg.size());
+
+      closed = !read_header(fd, header);
+      close(fd);
+   });
+
+   const int fd = connect_to_server(path);
+   std::vector<std::string> messages;
+   const auto results = evaluate_remote(fd, point, 1, &messages);
+
+   test_equal("remote results", results.size() == NUMBER_OF_RESULTS*2 && results.back() == point[5]);
+   test_equal("remote diagnostics", messages.size() == 1 && messages[0] == "warning\n");
+
+   std::string error;
+
+   try {
+      evaluate_remote(fd, point, 1);
+   } catch (const Server_error& e) {
+      error = e.what();
+   }
+
+   test_equal("remote error", error == "invalid point");
+
+   close(fd);
+   server.join();
+   close(listener);
+   unlink(path.c_str());
+
+   test_equal("connection closed", closed);
+}
+
+void test_errors()
+{
+   bool thrown = false;
+
+   try {
+      make_parameters({1, 2, 3});
+   } catch (const std::exception&) {
+      thrown = true;
+   }
+
+   test_equal("wrong number of parameters", thrown);
+
+   thrown = false;
+
+   try {
+      calculate_results(Parameters{x, y, z, u, v, s, 0, qq}, {"Foo"});
+   } catch (const std::exception&) {
+      thrown = true;
+   }
+
+   test_equal("unknown result name", thrown);
+}
+
+} // anonymous namespace
+
+int main()
+{
+   test_results();
+   test_batch();
+   test_thread_pool();
+   test_chunks();
+   test_sweep();
+   test_session();
+   test_find_pole();
+   test_error_estimate();
+   test_rescale();
+   test_selected_results();
+   test_integrals();
+   test_cache_normalization();
+   test_non_finite_keys();
+   test_function_statistics();
+   test_result_store();
+   test_protocol();
+   test_errors();
+
+   std::cout << "Passed tests: " << passed_tests << std::endl;
+   std::cout << "Failed tests: " << failed_tests << std::endl;
+
+   return failed_tests == 0 ? 0 : 1;
+}